@@ -21,11 +21,90 @@
 #include "argument.h"
 #include "tree_builder.h"
 
+#include <cstddef>
 #include <exception>
 #include <iostream>
 #include <string>
 #include <vector>
 
+/**
+ * @brief Get a numeric value of an option that has a short and a long name
+ *
+ * @param arg_parser Command line arguments parser
+ * @param short_name Short name of the option
+ * @param long_name Long name of the option
+ * @param value Value of the option (unchanged if the option is not specified)
+ * @return true if the option is not specified or has a valid value, false otherwise
+ */
+static bool getNumericOption(const ArgParserEx& arg_parser, const std::string& short_name,
+                             const std::string& long_name, unsigned long long& value)
+{
+    std::string short_arg_val = arg_parser.getArgumentValue(short_name);
+    std::string long_arg_val = arg_parser.getArgumentValue(long_name);
+
+    // Do not allow both short and long options at the same time
+    if(!short_arg_val.empty() && !long_arg_val.empty())
+    {
+        std::cerr << "Error: both \'" << short_name << "\' and \'" << long_name
+                  << "\' are specified\n"
+                  << "Use \'prepare_data -h\' or \'prepare_data --help\' to display help\n";
+        return false;
+    }
+
+    std::string arg_val = short_arg_val.empty() ? long_arg_val : short_arg_val;
+
+    if(arg_val.empty())
+    {
+        return true;
+    }
+
+    try
+    {
+        std::size_t end;
+        value = std::stoull(arg_val, &end);
+
+        if(end == arg_val.size() && arg_val[0] != '-')
+        {
+            return true;
+        }
+    }
+    catch(const std::exception&)
+    {
+    }
+
+    std::cerr << "Error: invalid value \'" << arg_val << "\' for \'" << short_name << "\' or \'"
+              << long_name << "\'\n";
+    return false;
+}
+
+/**
+ * @brief Get a value of an option that has a short and a long name
+ *
+ * @param arg_parser Command line arguments parser
+ * @param short_name Short name of the option
+ * @param long_name Long name of the option
+ * @param value Value of the option (empty if the option is not specified)
+ * @return true if at most one of the names is specified, false otherwise
+ */
+static bool getOption(const ArgParserEx& arg_parser, const std::string& short_name,
+                      const std::string& long_name, std::string& value)
+{
+    std::string short_arg_val = arg_parser.getArgumentValue(short_name);
+    std::string long_arg_val = arg_parser.getArgumentValue(long_name);
+
+    // Do not allow both short and long options at the same time
+    if(!short_arg_val.empty() && !long_arg_val.empty())
+    {
+        std::cerr << "Error: both \'" << short_name << "\' and \'" << long_name
+                  << "\' are specified\n"
+                  << "Use \'prepare_data -h\' or \'prepare_data --help\' to display help\n";
+        return false;
+    }
+
+    value = short_arg_val.empty() ? long_arg_val : short_arg_val;
+    return true;
+}
+
 int main(int argc, char* argv[])
 {
     // List of valid arguments
@@ -36,8 +115,34 @@ int main(int argc, char* argv[])
                                   Argument(false, "--wordlist", ""),
                                   Argument(false, "-t", ""),
                                   Argument(false, "--build-trie", ""),
+                                  Argument(false, "-a", ""),
+                                  Argument(false, "--build-double-array", ""),
+                                  Argument(true, "-g", "false"),
+                                  Argument(true, "--dawg", "false"),
                                   Argument(false, "-b", ""),
-                                  Argument(false, "--build-bktree", "")};
+                                  Argument(false, "--build-bktree", ""),
+                                  Argument(true, "-m", "false"),
+                                  Argument(true, "--mmap", "false"),
+                                  Argument(false, "-j", ""),
+                                  Argument(false, "--threads", ""),
+                                  Argument(false, "-s", ""),
+                                  Argument(false, "--seed", ""),
+                                  Argument(false, "-o", ""),
+                                  Argument(false, "--optimize", ""),
+                                  Argument(false, "-f", ""),
+                                  Argument(false, "--forest", ""),
+                                  Argument(false, "-d", ""),
+                                  Argument(false, "--build-deletion-index", ""),
+                                  Argument(false, "-e", ""),
+                                  Argument(false, "--max-deletions", ""),
+                                  Argument(false, "-p", ""),
+                                  Argument(false, "--prefix-length", ""),
+                                  Argument(false, "-u", ""),
+                                  Argument(false, "--update", ""),
+                                  Argument(false, "-x", ""),
+                                  Argument(false, "--delta", ""),
+                                  Argument(false, "-c", ""),
+                                  Argument(false, "--compact", "")};
 
     // Initialize a command line argument parser
     ArgParserEx arg_parser(argc, argv, args);
@@ -63,15 +168,89 @@ int main(int argc, char* argv[])
                   << "  -w, --wordlist\t\tInput file with the list of words\n"
                   << "\t\t\t\t\t\t(always required)\n"
                   << "  -t, --build-trie\t\tOutput file with created Trie\n"
-                  << "\t\t\t\t\t\t(required if --build-bktree is not used)\n"
+                  << "\t\t\t\t\t\t(required if no other output file is used)\n"
+                  << "  -a, --build-double-array\tOutput file with created double-array trie\n"
+                  << "\t\t\t\t\t\t(memory-mappable, required if no other output file is used)\n"
                   << "  -b, --build-bktree\tOutput file with created BK-tree\n"
-                  << "\t\t\t\t\t\t(required if --build-trie is not used)\n\n"
+                  << "\t\t\t\t\t\t(required if no other output file is used)\n"
+                  << "  -d, --build-deletion-index\tOutput file with created deletion index\n"
+                  << "\t\t\t\t\t\t(required if no other output file is used)\n\n"
                   << "Optional parameters:\n"
+                  << "  -g, --dawg\t\t\tWrite the Trie as a minimized DAWG, which shares\n"
+                  << "\t\t\t\t\t\tequal word endings\n"
+                  << "  -m, --mmap\t\t\tWrite the BK-tree in the memory-mappable format\n"
+                  << "  -j, --threads\t\tNumber of threads used to build the BK-tree\n"
+                  << "\t\t\t\t\t\t(one per hardware thread by default)\n"
+                  << "  -s, --seed\t\t\tSeed of the random insertion order of the BK-tree\n"
+                  << "\t\t\t\t\t\t(random by default, recorded in the output file)\n"
+                  << "  -o, --optimize\t\tNumber of random insertion orders to try, the BK-tree\n"
+                  << "\t\t\t\t\t\twith the lowest estimated query cost is kept\n"
+                  << "  -f, --forest\t\tWrite a forest of BK-trees, one per band of word lengths\n"
+                  << "\t\t\t\t\t\tof the given width, instead of a single BK-tree\n"
+                  << "  -e, --max-deletions\tMaximum number of deletions indexed for every word\n"
+                  << "\t\t\t\t\t\tof the deletion index (2 by default)\n"
+                  << "  -p, --prefix-length\tNumber of leading characters of a word indexed by\n"
+                  << "\t\t\t\t\t\tthe deletion index (7 by default, 0 means all)\n"
+                  << "  -u, --update\t\tExisting BK-tree file, the words of the wordlist that\n"
+                  << "\t\t\t\t\t\tare not in it are appended to its delta file\n"
+                  << "  -x, --delta\t\t\tDelta file of the existing BK-tree\n"
+                  << "\t\t\t\t\t\t(the BK-tree file with '.delta' appended by default)\n"
+                  << "  -c, --compact\t\tOutput file with the existing BK-tree merged with its\n"
+                  << "\t\t\t\t\t\tdelta file, the delta file is removed (no wordlist needed)\n"
                   << "  -h, --help\t\t\tDisplay this usage information\n\n"
                   << "Examples:\n"
                   << "  prepare_data -w wordlist.txt -t trie.dat\n"
+                  << "  prepare_data -w wordlist.txt -t dawg.dat -g\n"
+                  << "  prepare_data -w wordlist.txt -a datrie.dat\n"
                   << "  prepare_data -w wordlist.txt -b bktree.dat\n"
-                  << "  prepare_data -w wordlist.txt -t trie.dat -b bktree.dat\n";
+                  << "  prepare_data -w wordlist.txt -t trie.dat -b bktree.dat\n"
+                  << "  prepare_data -w wordlist.txt -b bktree.dat -m\n"
+                  << "  prepare_data -w wordlist.txt -b bktree.dat -s 42 -o 8\n"
+                  << "  prepare_data -w wordlist.txt -b bkforest.dat -f 1\n"
+                  << "  prepare_data -w wordlist.txt -d delindex.dat -e 2 -p 7\n"
+                  << "  prepare_data -w added.txt -u bktree.dat\n"
+                  << "  prepare_data -u bktree.dat -c bktree.dat\n";
+        return 0;
+    }
+
+    // Get values for '-u'/'--update', '-x'/'--delta' and '-c'/'--compact'
+    std::string base_filepath;
+    std::string delta_filepath;
+    std::string compact_filepath;
+
+    if(!getOption(arg_parser, "-u", "--update", base_filepath) ||
+       !getOption(arg_parser, "-x", "--delta", delta_filepath) ||
+       !getOption(arg_parser, "-c", "--compact", compact_filepath))
+    {
+        return 1;
+    }
+
+    if(base_filepath.empty() && (!delta_filepath.empty() || !compact_filepath.empty()))
+    {
+        std::cerr << "Error: a delta file or compaction needs an existing BK-tree given by "
+                  << "\'-u\' or \'--update\'\n"
+                  << "Use \'prepare_data -h\' or \'prepare_data --help\' to display help\n";
+        return 1;
+    }
+
+    if(delta_filepath.empty())
+    {
+        delta_filepath = base_filepath + ".delta";
+    }
+
+    if(!compact_filepath.empty())
+    {
+        try
+        {
+            // Merge the delta file into a new base BK-tree
+            TreeBuilder().compactBKTree(base_filepath, delta_filepath, compact_filepath);
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << '\n';
+            return 1;
+        }
+
         return 0;
     }
 
@@ -110,6 +289,20 @@ int main(int argc, char* argv[])
         return 1;
     }
 
+    if(!base_filepath.empty())
+    {
+        try
+        {
+            // Append the new words to the delta file of the existing BK-tree
+            tree_builder.updateBKTree(base_filepath, delta_filepath);
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << '\n';
+            return 1;
+        }
+    }
+
     // Get values for '-t' and '--build-trie'
     short_arg_val = arg_parser.getArgumentValue("-t");
     long_arg_val = arg_parser.getArgumentValue("--build-trie");
@@ -127,10 +320,51 @@ int main(int argc, char* argv[])
 
         value = short_arg_val.empty() ? long_arg_val : short_arg_val;
 
+        // Check if a DAWG is requested instead of a Trie
+        bool dawg = arg_parser.getArgumentValue("-g") == "true" ||
+                    arg_parser.getArgumentValue("--dawg") == "true";
+
         try
         {
-            // Build a Trie (prefix tree)
-            tree_builder.buildTrie(value);
+            if(dawg)
+            {
+                // Build a minimized DAWG (directed acyclic word graph)
+                tree_builder.buildDawg(value);
+            }
+            else
+            {
+                // Build a Trie (prefix tree)
+                tree_builder.buildTrie(value);
+            }
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << '\n';
+            return 1;
+        }
+    }
+
+    // Get values for '-a' and '--build-double-array'
+    short_arg_val = arg_parser.getArgumentValue("-a");
+    long_arg_val = arg_parser.getArgumentValue("--build-double-array");
+
+    // Check if either '-a' or '--build-double-array' has value
+    if(!short_arg_val.empty() || !long_arg_val.empty())
+    {
+        // Do not allow both '-a' and '--build-double-array' options at the same time
+        if(!short_arg_val.empty() && !long_arg_val.empty())
+        {
+            std::cerr << "Error: both \'-a\' and \'--build-double-array\' are specified\n"
+                      << "Use \'prepare_data -h\' or \'prepare_data --help\' to display help\n";
+            return 1;
+        }
+
+        value = short_arg_val.empty() ? long_arg_val : short_arg_val;
+
+        try
+        {
+            // Build a double-array trie
+            tree_builder.buildDoubleArrayTrie(value);
         }
         catch(const std::exception& e)
         {
@@ -156,10 +390,107 @@ int main(int argc, char* argv[])
 
         value = short_arg_val.empty() ? long_arg_val : short_arg_val;
 
+        // Check if the memory-mappable format is requested
+        bool mappable = arg_parser.getArgumentValue("-m") == "true" ||
+                        arg_parser.getArgumentValue("--mmap") == "true";
+
+        // Get values for '-j'/'--threads', '-s'/'--seed' and '-o'/'--optimize'
+        unsigned long long threads = 0;
+        unsigned long long candidates = 1;
+
+        if(!getNumericOption(arg_parser, "-j", "--threads", threads) ||
+           !getNumericOption(arg_parser, "-o", "--optimize", candidates))
+        {
+            return 1;
+        }
+
+        tree_builder.setThreads(static_cast<unsigned int>(threads));
+        tree_builder.setCandidates(static_cast<unsigned int>(candidates));
+
+        // Without a seed, the random seed chosen by the builder is recorded in the output file
+        if(!arg_parser.getArgumentValue("-s").empty() ||
+           !arg_parser.getArgumentValue("--seed").empty())
+        {
+            unsigned long long seed = 0;
+
+            if(!getNumericOption(arg_parser, "-s", "--seed", seed))
+            {
+                return 1;
+            }
+
+            tree_builder.setSeed(seed);
+        }
+
+        // Get values for '-f' and '--forest'
+        unsigned long long band_width = 0;
+
+        if(!getNumericOption(arg_parser, "-f", "--forest", band_width))
+        {
+            return 1;
+        }
+
+        bool forest = !arg_parser.getArgumentValue("-f").empty() ||
+                      !arg_parser.getArgumentValue("--forest").empty();
+
+        if(forest && (band_width == 0 || mappable))
+        {
+            std::cerr << "Error: a BK-forest needs a positive band width and can not be "
+                      << "memory-mapped\n"
+                      << "Use \'prepare_data -h\' or \'prepare_data --help\' to display help\n";
+            return 1;
+        }
+
+        try
+        {
+            // Build a BK-tree or a forest of BK-trees
+            if(forest)
+            {
+                tree_builder.buildBKForest(value, static_cast<unsigned int>(band_width));
+            }
+            else
+            {
+                tree_builder.buildBKTree(value, mappable);
+            }
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << '\n';
+            return 1;
+        }
+    }
+
+    // Get values for '-d' and '--build-deletion-index'
+    short_arg_val = arg_parser.getArgumentValue("-d");
+    long_arg_val = arg_parser.getArgumentValue("--build-deletion-index");
+
+    // Check if either '-d' or '--build-deletion-index' has value
+    if(!short_arg_val.empty() || !long_arg_val.empty())
+    {
+        // Do not allow both '-d' and '--build-deletion-index' options at the same time
+        if(!short_arg_val.empty() && !long_arg_val.empty())
+        {
+            std::cerr << "Error: both \'-d\' and \'--build-deletion-index\' are specified\n"
+                      << "Use \'prepare_data -h\' or \'prepare_data --help\' to display help\n";
+            return 1;
+        }
+
+        value = short_arg_val.empty() ? long_arg_val : short_arg_val;
+
+        // Get values for '-e'/'--max-deletions' and '-p'/'--prefix-length'
+        unsigned long long max_deletions = 2;
+        unsigned long long prefix_length = 7;
+
+        if(!getNumericOption(arg_parser, "-e", "--max-deletions", max_deletions) ||
+           !getNumericOption(arg_parser, "-p", "--prefix-length", prefix_length))
+        {
+            return 1;
+        }
+
         try
         {
-            // Build a BK-tree
-            tree_builder.buildBKTree(value);
+            // Build a symmetric deletion index
+            tree_builder.buildDeletionIndex(value, static_cast<unsigned int>(max_deletions),
+                                            static_cast<unsigned int>(prefix_length));
         }
         catch(const std::exception& e)
         {
@@ -19,11 +19,19 @@
 
 #include "tree_builder.h"
 
+#include "bk_forest.h"
 #include "bk_tree.h"
+#include "dawg.h"
+#include "deletion_index.h"
+#include "double_array_trie.h"
+#include "flat_bk_tree.h"
 #include "trie.h"
 
 #include <algorithm>
 #include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
 #include <fstream>
 #include <ios>
 #include <iostream>
@@ -31,12 +39,20 @@
 #include <random>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 /**
  * @brief Default constructor
  *
  */
-TreeBuilder::TreeBuilder() : words() {}
+TreeBuilder::TreeBuilder() :
+    words(),
+    threads(0),
+    seed((static_cast<std::uint64_t>(std::random_device{}()) << 32) | std::random_device{}()),
+    candidates(1)
+{
+}
 
 /**
  * @brief Read a list of words from the file
@@ -66,6 +82,38 @@ void TreeBuilder::readWordlist(const std::string& filepath)
     file.close();
 }
 
+/**
+ * @brief Set the number of threads used to build a BK-tree
+ *
+ * @param threads Number of threads (0 means one per hardware thread)
+ */
+void TreeBuilder::setThreads(unsigned int threads)
+{
+    this->threads = threads;
+}
+
+/**
+ * @brief Set the seed of the random insertion order of a BK-tree.
+ * The same seed and list of words always produce the same tree
+ *
+ * @param seed Seed
+ */
+void TreeBuilder::setSeed(std::uint64_t seed)
+{
+    this->seed = seed;
+}
+
+/**
+ * @brief Set the number of random insertion orders to try when building a BK-tree.
+ * The tree with the lowest estimated query cost is kept
+ *
+ * @param candidates Number of insertion orders
+ */
+void TreeBuilder::setCandidates(unsigned int candidates)
+{
+    this->candidates = candidates;
+}
+
 /**
  * @brief Create and serialize a Trie (prefix tree)
  *
@@ -91,22 +139,146 @@ void TreeBuilder::buildTrie(const std::string& filepath)
     file.close();
 }
 
+/**
+ * @brief Create and serialize a minimized DAWG (directed acyclic word graph), which
+ * answers the same queries as a Trie
+ *
+ * @param filepath Path to the output file
+ */
+void TreeBuilder::buildDawg(const std::string& filepath)
+{
+    Dawg dawg;
+    dawg.build(this->words);
+
+    std::ofstream file(filepath, std::ios::binary);
+
+    if(!file.is_open() || !file.good())
+    {
+        throw std::runtime_error("could not create/open file " + filepath);
+    }
+
+    dawg.serialize(file);
+    file.close();
+}
+
+/**
+ * @brief Create and serialize a double-array trie in the memory-mappable format
+ * (see DoubleArrayTrie)
+ *
+ * @param filepath Path to the output file
+ */
+void TreeBuilder::buildDoubleArrayTrie(const std::string& filepath)
+{
+    DoubleArrayTrie trie;
+    trie.build(this->words);
+
+    std::ofstream file(filepath, std::ios::binary);
+
+    if(!file.is_open() || !file.good())
+    {
+        throw std::runtime_error("could not create/open file " + filepath);
+    }
+
+    trie.serialize(file);
+    file.close();
+}
+
 /**
  * @brief Create and serialize a BK-tree
  *
  * @param filepath Path to the output file
+ * @param mappable Write the tree in the memory-mappable format (see FlatBKTree)
  */
-void TreeBuilder::buildBKTree(const std::string& filepath)
+void TreeBuilder::buildBKTree(const std::string& filepath, bool mappable)
 {
-    // Randomly shuffle the words for achieving a better balance in the tree
-    std::shuffle(std::begin(this->words), std::end(this->words),
-                 std::mt19937{std::random_device{}()});
+    // Queries for estimating the cost of the candidate trees
+    std::mt19937_64 rng(this->seed);
+    std::vector<std::string> queries = this->sampleQueries(rng);
 
     BKTree tree;
 
+    // Candidate i shuffles the words with seed + i, so the seed recorded for the best
+    // candidate rebuilds exactly the same tree
+    for(unsigned int i = 0; i < std::max(this->candidates, 1u); i++)
+    {
+        std::uint64_t candidate_seed = this->seed + i;
+
+        // Randomly shuffle the words for achieving a better balance in the tree
+        std::vector<std::string> order = this->words;
+        std::shuffle(std::begin(order), std::end(order), std::mt19937_64{candidate_seed});
+
+        BKTree candidate;
+        candidate.build(order, this->threads);
+        candidate.setSeed(candidate_seed);
+        candidate.setCost(candidate.estimateCost(queries));
+
+        if(i == 0 || candidate.getCost() < tree.getCost())
+        {
+            tree = std::move(candidate);
+        }
+    }
+
+    std::ofstream file(filepath, std::ios::binary);
+
+    if(!file.is_open() || !file.good())
+    {
+        throw std::runtime_error("could not create/open file " + filepath);
+    }
+
+    if(mappable)
+    {
+        FlatBKTree(tree).serialize(file);
+    }
+    else
+    {
+        tree.serialize(file);
+    }
+
+    file.close();
+}
+
+/**
+ * @brief Create and serialize a forest of BK-trees sharded by word length
+ *
+ * @param filepath Path to the output file
+ * @param band_width Number of word lengths in the band of every tree
+ */
+void TreeBuilder::buildBKForest(const std::string& filepath, unsigned int band_width)
+{
+    // Randomly shuffle the words for achieving a better balance in the trees
+    std::vector<std::string> order = this->words;
+    std::shuffle(std::begin(order), std::end(order), std::mt19937_64{this->seed});
+
+    BKForest forest(band_width);
+    forest.build(order, this->threads, this->seed);
+
+    std::ofstream file(filepath, std::ios::binary);
+
+    if(!file.is_open() || !file.good())
+    {
+        throw std::runtime_error("could not create/open file " + filepath);
+    }
+
+    forest.serialize(file);
+    file.close();
+}
+
+/**
+ * @brief Create and serialize a symmetric deletion index
+ *
+ * @param filepath Path to the output file
+ * @param max_deletions Maximum number of deletions indexed for every word
+ * @param prefix_length Number of leading characters of a word that deletions are
+ * generated from (0 means the whole word)
+ */
+void TreeBuilder::buildDeletionIndex(const std::string& filepath, unsigned int max_deletions,
+                                     unsigned int prefix_length)
+{
+    DeletionIndex index(max_deletions, prefix_length);
+
     for(const std::string& word : this->words)
     {
-        tree.insert(word);
+        index.insert(word);
     }
 
     std::ofstream file(filepath, std::ios::binary);
@@ -116,8 +288,149 @@ void TreeBuilder::buildBKTree(const std::string& filepath)
         throw std::runtime_error("could not create/open file " + filepath);
     }
 
+    index.serialize(file);
+    file.close();
+}
+
+/**
+ * @brief Append a delta segment with the words that are not yet in a serialized
+ * BK-tree (including its existing delta) to the delta file of the tree
+ *
+ * @param base_filepath Path to the file with the base BK-tree
+ * @param delta_filepath Path to the delta file (created if it does not exist)
+ */
+void TreeBuilder::updateBKTree(const std::string& base_filepath,
+                               const std::string& delta_filepath)
+{
+    BKTree tree;
+    this->loadBKTree(base_filepath, delta_filepath, tree);
+
+    // Inserting the added words also skips their duplicates
+    std::vector<std::string> added;
+
+    for(const std::string& word : this->words)
+    {
+        if(tree.insert(word))
+        {
+            added.push_back(word);
+        }
+    }
+
+    if(added.empty())
+    {
+        return;
+    }
+
+    std::ofstream file(delta_filepath, std::ios::binary | std::ios::app);
+
+    if(!file.is_open() || !file.good())
+    {
+        throw std::runtime_error("could not create/open file " + delta_filepath);
+    }
+
+    BKTree::serializeDelta(file, added);
+    file.close();
+}
+
+/**
+ * @brief Merge the delta file of a serialized BK-tree into a new base BK-tree.
+ * The delta file is removed afterwards
+ *
+ * @param base_filepath Path to the file with the base BK-tree
+ * @param delta_filepath Path to the delta file (may not exist)
+ * @param filepath Path to the output file (may be the same as the base file)
+ */
+void TreeBuilder::compactBKTree(const std::string& base_filepath,
+                                const std::string& delta_filepath, const std::string& filepath)
+{
+    BKTree tree;
+    this->loadBKTree(base_filepath, delta_filepath, tree);
+
+    // The output is usually the base file itself, so it is only replaced once the new
+    // tree is completely written
+    std::string temp_filepath = filepath + ".tmp";
+    std::ofstream file(temp_filepath, std::ios::binary);
+
+    if(!file.is_open() || !file.good())
+    {
+        throw std::runtime_error("could not create/open file " + temp_filepath);
+    }
+
     tree.serialize(file);
     file.close();
+
+    if(!file)
+    {
+        std::remove(temp_filepath.c_str());
+        throw std::runtime_error("could not write file " + temp_filepath);
+    }
+
+    if(std::rename(temp_filepath.c_str(), filepath.c_str()) != 0)
+    {
+        std::remove(temp_filepath.c_str());
+        throw std::runtime_error("could not replace file " + filepath);
+    }
+
+    // The delta is merged into the output, so it is only removed after the output is in place
+    std::remove(delta_filepath.c_str());
+}
+
+/**
+ * @brief Create a sample of damaged words for estimating the query cost of a BK-tree.
+ * Every query is a random word with one random edit
+ *
+ * @param rng Random number generator
+ * @return Sample of queries
+ */
+std::vector<std::string> TreeBuilder::sampleQueries(std::mt19937_64& rng) const
+{
+    const std::size_t sample_size = 200;
+
+    std::vector<std::string> queries;
+
+    if(this->words.empty())
+    {
+        return queries;
+    }
+
+    std::uniform_int_distribution<std::size_t> word_dist(0, this->words.size() - 1);
+    std::uniform_int_distribution<int> edit_dist(0, 3);
+    std::uniform_int_distribution<int> letter_dist('a', 'z');
+
+    for(std::size_t i = 0; i < sample_size; i++)
+    {
+        std::string query = this->words[word_dist(rng)];
+
+        if(query.empty())
+        {
+            continue;
+        }
+
+        std::size_t pos = std::uniform_int_distribution<std::size_t>(0, query.size() - 1)(rng);
+
+        switch(edit_dist(rng))
+        {
+        case 0: // substitution
+            query[pos] = static_cast<char>(letter_dist(rng));
+            break;
+        case 1: // deletion
+            query.erase(pos, 1);
+            break;
+        case 2: // insertion
+            query.insert(pos, 1, static_cast<char>(letter_dist(rng)));
+            break;
+        default: // transposition
+            if(pos + 1 < query.size())
+            {
+                std::swap(query[pos], query[pos + 1]);
+            }
+            break;
+        }
+
+        queries.push_back(query);
+    }
+
+    return queries;
 }
 
 /**
@@ -170,3 +483,31 @@ bool TreeBuilder::isValidString(const std::string& s) const
 
     return true;
 }
+
+/**
+ * @brief Load a serialized BK-tree and apply its delta file
+ *
+ * @param base_filepath Path to the file with the base BK-tree
+ * @param delta_filepath Path to the delta file (skipped if it does not exist)
+ * @param tree Loaded BK-tree
+ */
+void TreeBuilder::loadBKTree(const std::string& base_filepath, const std::string& delta_filepath,
+                             BKTree& tree) const
+{
+    std::ifstream base_file(base_filepath, std::ios::binary);
+
+    if(!base_file.is_open() || !base_file.good())
+    {
+        throw std::runtime_error("could not open file " + base_filepath);
+    }
+
+    tree.deserialize(base_file);
+    base_file.close();
+
+    std::ifstream delta_file(delta_filepath, std::ios::binary);
+
+    if(delta_file.is_open())
+    {
+        tree.applyDelta(delta_file);
+    }
+}
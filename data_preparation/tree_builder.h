@@ -20,12 +20,17 @@
 #ifndef TREE_BUILDER_H_INCLUDED
 #define TREE_BUILDER_H_INCLUDED
 
+#include <cstdint>
+#include <random>
 #include <string>
 #include <vector>
 
+class BKTree;
+
 /**
  * @brief Class for reading a list of words from a file and creating
- * tree data structures. Supports Trie (prefix tree) and a BK-tree
+ * tree data structures. Supports Trie (prefix tree), a DAWG, a double-array trie,
+ * a BK-tree and a deletion index
  *
  */
 class TreeBuilder
@@ -36,6 +41,21 @@ private:
      *
      */
     std::vector<std::string> words;
+    /**
+     * @brief Number of threads used to build a BK-tree (0 means one per hardware thread)
+     *
+     */
+    unsigned int threads;
+    /**
+     * @brief Seed of the random insertion order of a BK-tree
+     *
+     */
+    std::uint64_t seed;
+    /**
+     * @brief Number of random insertion orders to try when building a BK-tree
+     *
+     */
+    unsigned int candidates;
 
 public:
     /**
@@ -51,6 +71,29 @@ public:
      */
     void readWordlist(const std::string& filepath);
 
+    /**
+     * @brief Set the number of threads used to build a BK-tree
+     *
+     * @param threads Number of threads (0 means one per hardware thread)
+     */
+    void setThreads(unsigned int threads);
+
+    /**
+     * @brief Set the seed of the random insertion order of a BK-tree.
+     * The same seed and list of words always produce the same tree
+     *
+     * @param seed Seed
+     */
+    void setSeed(std::uint64_t seed);
+
+    /**
+     * @brief Set the number of random insertion orders to try when building a BK-tree.
+     * The tree with the lowest estimated query cost is kept
+     *
+     * @param candidates Number of insertion orders
+     */
+    void setCandidates(unsigned int candidates);
+
     /**
      * @brief Create and serialize a Trie (prefix tree)
      *
@@ -58,12 +101,68 @@ public:
      */
     void buildTrie(const std::string& filepath);
 
+    /**
+     * @brief Create and serialize a minimized DAWG (directed acyclic word graph), which
+     * answers the same queries as a Trie
+     *
+     * @param filepath Path to the output file
+     */
+    void buildDawg(const std::string& filepath);
+
+    /**
+     * @brief Create and serialize a double-array trie in the memory-mappable format
+     * (see DoubleArrayTrie)
+     *
+     * @param filepath Path to the output file
+     */
+    void buildDoubleArrayTrie(const std::string& filepath);
+
     /**
      * @brief Create and serialize a BK-tree
      *
      * @param filepath Path to the output file
+     * @param mappable Write the tree in the memory-mappable format (see FlatBKTree)
+     */
+    void buildBKTree(const std::string& filepath, bool mappable = false);
+
+    /**
+     * @brief Create and serialize a forest of BK-trees sharded by word length
+     *
+     * @param filepath Path to the output file
+     * @param band_width Number of word lengths in the band of every tree
      */
-    void buildBKTree(const std::string& filepath);
+    void buildBKForest(const std::string& filepath, unsigned int band_width);
+
+    /**
+     * @brief Create and serialize a symmetric deletion index
+     *
+     * @param filepath Path to the output file
+     * @param max_deletions Maximum number of deletions indexed for every word
+     * @param prefix_length Number of leading characters of a word that deletions are
+     * generated from (0 means the whole word)
+     */
+    void buildDeletionIndex(const std::string& filepath, unsigned int max_deletions,
+                            unsigned int prefix_length);
+
+    /**
+     * @brief Append a delta segment with the words that are not yet in a serialized
+     * BK-tree (including its existing delta) to the delta file of the tree
+     *
+     * @param base_filepath Path to the file with the base BK-tree
+     * @param delta_filepath Path to the delta file (created if it does not exist)
+     */
+    void updateBKTree(const std::string& base_filepath, const std::string& delta_filepath);
+
+    /**
+     * @brief Merge the delta file of a serialized BK-tree into a new base BK-tree.
+     * The delta file is removed afterwards
+     *
+     * @param base_filepath Path to the file with the base BK-tree
+     * @param delta_filepath Path to the delta file (may not exist)
+     * @param filepath Path to the output file (may be the same as the base file)
+     */
+    void compactBKTree(const std::string& base_filepath, const std::string& delta_filepath,
+                       const std::string& filepath);
 
 private:
     /**
@@ -81,6 +180,25 @@ private:
      * @return true if a string only contains English lowercase letters, false otherwise
      */
     bool isValidString(const std::string& s) const;
+
+    /**
+     * @brief Create a sample of damaged words for estimating the query cost of a BK-tree.
+     * Every query is a random word with one random edit
+     *
+     * @param rng Random number generator
+     * @return Sample of queries
+     */
+    std::vector<std::string> sampleQueries(std::mt19937_64& rng) const;
+
+    /**
+     * @brief Load a serialized BK-tree and apply its delta file
+     *
+     * @param base_filepath Path to the file with the base BK-tree
+     * @param delta_filepath Path to the delta file (skipped if it does not exist)
+     * @param tree Loaded BK-tree
+     */
+    void loadBKTree(const std::string& base_filepath, const std::string& delta_filepath,
+                    BKTree& tree) const;
 };
 
 #endif // TREE_BUILDER_H_INCLUDED
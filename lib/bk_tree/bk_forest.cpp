@@ -0,0 +1,252 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "bk_forest.h"
+#include "bk_tree.h"
+#include "byte_reader.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Magic bytes at the start of a serialized BK-forest
+ *
+ */
+static const char BK_FOREST_MAGIC[4] = {'T', 'R', 'B', 'F'};
+/**
+ * @brief Version of the serialized BK-forest format
+ *
+ */
+static const unsigned int BK_FOREST_FORMAT_VERSION = 1;
+
+/**
+ * @brief Constructor
+ *
+ * @param band_width Number of word lengths in a band (at least 1)
+ */
+BKForest::BKForest(unsigned int band_width) : band_width(std::max(band_width, 1u)), shards() {}
+
+/**
+ * @brief Get the number of word lengths in a band
+ *
+ * @return Number of word lengths in a band
+ */
+unsigned int BKForest::getBandWidth() const
+{
+    return this->band_width;
+}
+
+/**
+ * @brief Get the number of trees in the forest
+ *
+ * @return Number of trees
+ */
+std::size_t BKForest::getShardCount() const
+{
+    return this->shards.size();
+}
+
+/**
+ * @brief Insert a word into the tree of its band
+ *
+ * @param word A word to insert
+ */
+void BKForest::insert(const std::string& word)
+{
+    this->shards[this->bandOf(word.length())].insert(word);
+}
+
+/**
+ * @brief Build the forest from a list of words, replacing the current contents.
+ * The trees of different bands are built in parallel
+ *
+ * @param words Words in the order of insertion
+ * @param threads Number of threads (0 means one per hardware thread)
+ * @param seed Seed of the insertion order recorded in every tree
+ */
+void BKForest::build(const std::vector<std::string>& words, unsigned int threads,
+                     std::uint64_t seed)
+{
+    this->shards.clear();
+
+    // Words of every band in the order of insertion
+    std::map<unsigned int, std::vector<std::string>> bands;
+
+    for(const std::string& word : words)
+    {
+        bands[this->bandOf(word.length())].push_back(word);
+    }
+
+    std::vector<std::pair<BKTree*, const std::vector<std::string>*>> tasks;
+
+    for(const auto& it : bands)
+    {
+        tasks.emplace_back(&this->shards[it.first], &it.second);
+    }
+
+    Parallel::forEach(tasks.size(), threads,
+                      [&](std::size_t i)
+                      {
+                          tasks[i].first->build(*tasks[i].second, 1);
+                          tasks[i].first->setSeed(seed);
+                      });
+}
+
+/**
+ * @brief Find all words similar to the query within the tolerance value
+ *
+ * @param query Query
+ * @param tolerance Tolerance value (max edit distance)
+ * @param threads Number of threads searching the trees (0 means one per hardware thread)
+ * @return A list of matching words
+ */
+std::vector<std::string> BKForest::find(const std::string& query, unsigned int tolerance,
+                                        unsigned int threads) const
+{
+    // Only the bands of the lengths within the tolerance of the query length can match
+    std::size_t min_length = query.length() - std::min<std::size_t>(query.length(), tolerance);
+    std::size_t max_length = query.length() + tolerance;
+
+    std::vector<const BKTree*> trees;
+
+    for(auto it = this->shards.lower_bound(this->bandOf(min_length));
+        it != this->shards.end() && it->first <= this->bandOf(max_length); it++)
+    {
+        trees.push_back(&it->second);
+    }
+
+    std::vector<std::vector<std::string>> shard_results(trees.size());
+
+    Parallel::forEach(trees.size(), threads,
+                      [&](std::size_t i)
+                      {
+                          shard_results[i] = trees[i]->find(query, tolerance);
+                      });
+
+    std::vector<std::string> results;
+
+    for(std::vector<std::string>& shard_result : shard_results)
+    {
+        results.insert(results.end(), std::make_move_iterator(shard_result.begin()),
+                       std::make_move_iterator(shard_result.end()));
+    }
+
+    return results;
+}
+
+/**
+ * @brief Serialize the forest
+ *
+ * @param os Output stream
+ */
+void BKForest::serialize(std::ostream& os) const
+{
+    // Write the header: magic bytes, the version of the format, the band width
+    // and the number of trees
+    unsigned int version = BK_FOREST_FORMAT_VERSION;
+    unsigned int band_width = this->band_width;
+    unsigned int shard_count = static_cast<unsigned int>(this->shards.size());
+    os.write(BK_FOREST_MAGIC, sizeof(BK_FOREST_MAGIC));
+    os.write(reinterpret_cast<char*>(&version), sizeof(version));
+    os.write(reinterpret_cast<char*>(&band_width), sizeof(band_width));
+    os.write(reinterpret_cast<char*>(&shard_count), sizeof(shard_count));
+
+    // Write every tree after the index of its band
+    for(const auto& it : this->shards)
+    {
+        unsigned int band = it.first;
+        os.write(reinterpret_cast<char*>(&band), sizeof(band));
+        it.second.serialize(os);
+    }
+}
+
+/**
+ * @brief Deserialize the forest. The forest is only replaced if the data is valid
+ *
+ * @param is Input stream
+ */
+void BKForest::deserialize(std::istream& is)
+{
+    ByteReader::parseStream(is, [this](ByteReader& reader) { this->deserialize(reader); });
+}
+
+/**
+ * @brief Deserialize the forest from memory. The forest is only replaced
+ * if the data is valid
+ *
+ * @param reader Reader of the serialized data
+ */
+void BKForest::deserialize(ByteReader& reader)
+{
+    if(!reader.startsWith(BK_FOREST_MAGIC, sizeof(BK_FOREST_MAGIC)))
+    {
+        throw std::runtime_error("invalid BK-forest data");
+    }
+
+    reader.read(sizeof(BK_FOREST_MAGIC));
+    unsigned int version = reader.readValue<unsigned int>();
+
+    if(version > BK_FOREST_FORMAT_VERSION)
+    {
+        throw std::runtime_error("unsupported BK-forest format version " +
+                                 std::to_string(version));
+    }
+
+    unsigned int band_width = reader.readValue<unsigned int>();
+    unsigned int shard_count = reader.readValue<unsigned int>();
+
+    // The shards are read aside, so a corrupt file leaves the current forest intact
+    std::map<unsigned int, BKTree> shards;
+
+    for(unsigned int i = 0; i < shard_count; i++)
+    {
+        unsigned int band = reader.readValue<unsigned int>();
+
+        if(shards.count(band) != 0)
+        {
+            throw std::runtime_error("invalid BK-forest data");
+        }
+
+        shards[band].deserialize(reader);
+    }
+
+    this->band_width = std::max(band_width, 1u);
+    this->shards = std::move(shards);
+}
+
+/**
+ * @brief Get the band of a word length
+ *
+ * @param length Word length
+ * @return Band index
+ */
+unsigned int BKForest::bandOf(std::size_t length) const
+{
+    return static_cast<unsigned int>(length / this->band_width);
+}
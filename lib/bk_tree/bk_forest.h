@@ -0,0 +1,138 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BK_FOREST_H_INCLUDED
+#define BK_FOREST_H_INCLUDED
+
+#include "bk_tree.h"
+#include "byte_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Class that represents a forest of BK-trees sharded by word length. Every tree holds
+ * the words of one band of lengths, so a query of length L with tolerance k only searches
+ * the trees for the lengths from L - k to L + k (the edit distance is at least the
+ * difference of the lengths, and a wildcard stands for exactly one character)
+ *
+ */
+class BKForest
+{
+private:
+    /**
+     * @brief Number of word lengths in a band
+     *
+     */
+    unsigned int band_width;
+    /**
+     * @brief Trees by band index (the band of a word is its length divided by the band width)
+     *
+     */
+    std::map<unsigned int, BKTree> shards;
+
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param band_width Number of word lengths in a band (at least 1)
+     */
+    explicit BKForest(unsigned int band_width = 1);
+
+    /**
+     * @brief Get the number of word lengths in a band
+     *
+     * @return Number of word lengths in a band
+     */
+    unsigned int getBandWidth() const;
+
+    /**
+     * @brief Get the number of trees in the forest
+     *
+     * @return Number of trees
+     */
+    std::size_t getShardCount() const;
+
+    /**
+     * @brief Insert a word into the tree of its band
+     *
+     * @param word A word to insert
+     */
+    void insert(const std::string& word);
+
+    /**
+     * @brief Build the forest from a list of words, replacing the current contents.
+     * The trees of different bands are built in parallel
+     *
+     * @param words Words in the order of insertion
+     * @param threads Number of threads (0 means one per hardware thread)
+     * @param seed Seed of the insertion order recorded in every tree
+     */
+    void build(const std::vector<std::string>& words, unsigned int threads = 0,
+               std::uint64_t seed = 0);
+
+    /**
+     * @brief Find all words similar to the query within the tolerance value
+     *
+     * @param query Query
+     * @param tolerance Tolerance value (max edit distance)
+     * @param threads Number of threads searching the trees (0 means one per hardware thread)
+     * @return A list of matching words
+     */
+    std::vector<std::string> find(const std::string& query, unsigned int tolerance = 2,
+                                  unsigned int threads = 1) const;
+
+    /**
+     * @brief Serialize the forest
+     *
+     * @param os Output stream
+     */
+    void serialize(std::ostream& os) const;
+
+    /**
+     * @brief Deserialize the forest. The forest is only replaced if the data is valid
+     *
+     * @param is Input stream
+     */
+    void deserialize(std::istream& is);
+
+    /**
+     * @brief Deserialize the forest from memory. The forest is only replaced
+     * if the data is valid
+     *
+     * @param reader Reader of the serialized data
+     */
+    void deserialize(ByteReader& reader);
+
+private:
+    /**
+     * @brief Get the band of a word length
+     *
+     * @param length Word length
+     * @return Band index
+     */
+    unsigned int bandOf(std::size_t length) const;
+};
+
+#endif // BK_FOREST_H_INCLUDED
@@ -19,33 +19,575 @@
 
 #include "bk_tree.h"
 #include "bk_tree_node.h"
+#include "bk_tree_stats.h"
+#include "byte_reader.h"
+#include "edit_distance.h"
+#include "parallel.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+/**
+ * @brief Magic bytes at the start of a serialized BK-tree with a header
+ *
+ */
+static const char BK_TREE_MAGIC[4] = {'T', 'R', 'B', 'K'};
+/**
+ * @brief Magic bytes at the start of a delta segment
+ *
+ */
+static const char BK_TREE_DELTA_MAGIC[4] = {'T', 'R', 'B', 'D'};
+/**
+ * @brief Version of the delta segment format
+ *
+ */
+static const unsigned int BK_TREE_DELTA_VERSION = 1;
+
+/**
+ * @brief Number of words below the root of a subtree up to which BKTree::build inserts
+ * the words one by one instead of partitioning them further
+ *
+ */
+static const std::size_t BK_TREE_SEQUENTIAL_BUILD_SIZE = 1024;
+
+/**
+ * @brief A subtree that is being built by BKTree::build
+ *
+ */
+struct PendingSubtree
+{
+    /**
+     * @brief Root of the subtree
+     *
+     */
+    BKTreeNode* root;
+    /**
+     * @brief Word of the root
+     *
+     */
+    std::string pivot;
+    /**
+     * @brief Words below the root in the order of insertion
+     *
+     */
+    std::vector<const std::string*> words;
+};
+
+/**
+ * @brief A child node built by BKTree::build that is not attached to its parent yet
+ *
+ */
+struct PendingChild
+{
+    /**
+     * @brief Parent node
+     *
+     */
+    BKTreeNode* parent;
+    /**
+     * @brief Edit distance between the words of the parent and the child
+     *
+     */
+    int distance;
+    /**
+     * @brief Root of the subtree of the child
+     *
+     */
+    std::unique_ptr<BKTreeNode> node;
+};
+
+/**
+ * @brief Count the nodes and the deleted nodes of a subtree and find the topmost subtrees
+ * below its root whose fraction of deleted nodes exceeds the threshold
+ *
+ * @param node Root of the subtree
+ * @param threshold Fraction of deleted nodes
+ * @param path Edit distances of the edges from the root of the tree to the node
+ * @param rebuilds Subtrees to rebuild with their paths and node counts
+ * @param sources Roots of the subtrees to rebuild
+ * @param node_count Number of nodes of the subtree
+ * @param dead_count Number of deleted nodes of the subtree
+ */
+static void findDeadSubtrees(const BKTreeNode* node, double threshold, std::vector<int>& path,
+                             std::vector<BKTree::SubtreeRebuild>& rebuilds,
+                             std::vector<const BKTreeNode*>& sources, std::size_t& node_count,
+                             std::size_t& dead_count)
+{
+    node_count = 1;
+    dead_count = node->isDeleted() ? 1 : 0;
+
+    for(int distance : node->getChildDistances())
+    {
+        const BKTreeNode* child = node->getChild(distance);
+        std::size_t child_nodes = 0;
+        std::size_t child_dead = 0;
+
+        // Subtrees found below the child come last, they are replaced by the child
+        // if the whole subtree of the child is rebuilt
+        std::size_t first = rebuilds.size();
+
+        path.push_back(distance);
+        findDeadSubtrees(child, threshold, path, rebuilds, sources, child_nodes, child_dead);
+
+        if(child_dead > 0 && static_cast<double>(child_dead) > threshold * child_nodes)
+        {
+            rebuilds.resize(first);
+            sources.resize(first);
+
+            BKTree::SubtreeRebuild rebuild;
+            rebuild.path = path;
+            rebuild.node_count = child_nodes;
+            rebuild.dead_count = child_dead;
+            rebuilds.push_back(std::move(rebuild));
+            sources.push_back(child);
+        }
+
+        path.pop_back();
+        node_count += child_nodes;
+        dead_count += child_dead;
+    }
+}
+
+/**
+ * @brief Collect the words of a subtree that are not deleted, parents before children
+ *
+ * @param node Root of the subtree
+ * @param words Collected words
+ */
+static void collectWords(const BKTreeNode* node, std::vector<std::string>& words)
+{
+    if(!node->isDeleted())
+    {
+        words.push_back(node->getWord());
+    }
+
+    for(int distance : node->getChildDistances())
+    {
+        collectWords(node->getChild(distance), words);
+    }
+}
+
 /**
  * @brief Default constructor
  *
  */
-BKTree::BKTree() : root(nullptr) {}
+BKTree::BKTree() : root(nullptr), seed(0), cost(0.0), node_count(0), dead_count(0) {}
 
 /**
- * @brief Insert a word into a tree
+ * @brief Insert a word into a tree. A word that is already in the tree is not inserted again
  *
  * @param word A word to insert
+ * @return true if the word is inserted, false if it is already in the tree
  */
-void BKTree::insert(const std::string& word)
+bool BKTree::insert(const std::string& word)
 {
     // Check if root node was initialized (has a word)
     if(this->root == nullptr)
     {
         this->root = std::make_unique<BKTreeNode>();
         this->root.get()->setWord(word);
+        this->node_count = 1;
+        return true;
+    }
+
+    // A deleted node of the same word is restored instead of adding a node
+    bool restored;
+
+    if(!this->root.get()->insert(word, restored))
+    {
+        return false;
+    }
+
+    if(restored)
+    {
+        this->dead_count--;
+    }
+    else
+    {
+        this->node_count++;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Delete a word. Its node stays in the tree as a pivot of the search
+ * (tombstone), but the word is never reported
+ *
+ * @param word A word to delete
+ * @return true if the word is deleted, false if it is not in the tree
+ */
+bool BKTree::remove(const std::string& word)
+{
+    if(this->root == nullptr || !this->root.get()->remove(word))
+    {
+        return false;
+    }
+
+    this->dead_count++;
+    return true;
+}
+
+/**
+ * @brief Build a tree from a list of words, replacing the current contents. The words
+ * are recursively partitioned by their distance to the root of their subtree, every level
+ * of the partitioning runs in parallel. Subtrees with few words are built by sequential
+ * insertion, each on its own thread. The result is the same as inserting the words one by one
+ *
+ * @param words Words in the order of insertion
+ * @param threads Number of threads (0 means one per hardware thread)
+ */
+void BKTree::build(const std::vector<std::string>& words, unsigned int threads)
+{
+    this->root.reset();
+    this->node_count = 0;
+    this->dead_count = 0;
+
+    if(words.empty())
+    {
         return;
     }
 
-    this->root.get()->insert(word);
+    this->root = std::make_unique<BKTreeNode>();
+    this->root.get()->setWord(words[0]);
+
+    std::vector<PendingSubtree> level(1);
+    level[0].root = this->root.get();
+    level[0].pivot = words[0];
+
+    for(std::size_t i = 1; i < words.size(); i++)
+    {
+        level[0].words.push_back(&words[i]);
+    }
+
+    // Subtrees that are small enough to be built by sequential insertion
+    std::vector<PendingSubtree> small;
+    // Children are attached once their subtrees are complete, so that their parents
+    // get the final ranges of word lengths
+    std::vector<PendingChild> children;
+
+    while(!level.empty())
+    {
+        // Distances of the words of all subtrees of the level are calculated at once,
+        // so a single large subtree still keeps all threads busy
+        std::vector<std::size_t> offsets(level.size() + 1, 0);
+
+        for(std::size_t i = 0; i < level.size(); i++)
+        {
+            offsets[i + 1] = offsets[i] + level[i].words.size();
+        }
+
+        std::vector<int> distances(offsets.back());
+
+        Parallel::forEach(distances.size(), threads,
+                          [&](std::size_t i)
+                          {
+                              std::size_t j = std::upper_bound(offsets.begin(), offsets.end(),
+                                                               i) - offsets.begin() - 1;
+                              const std::string& word = *level[j].words[i - offsets[j]];
+                              distances[i] = EditDistance::editDistance(word, level[j].pivot);
+                          });
+
+        std::vector<PendingSubtree> next;
+
+        for(std::size_t i = 0; i < level.size(); i++)
+        {
+            // Partitions keep the order of insertion, so every subtree is built exactly
+            // as it would be by the sequential insertion
+            std::map<int, std::vector<const std::string*>> partitions;
+
+            for(std::size_t j = 0; j < level[i].words.size(); j++)
+            {
+                int distance = distances[offsets[i] + j];
+
+                // A repeated word of the root is skipped like by the insertion
+                if(distance == 0 && *level[i].words[j] == level[i].pivot)
+                {
+                    continue;
+                }
+
+                partitions[distance].push_back(level[i].words[j]);
+            }
+
+            for(auto& it : partitions)
+            {
+                PendingChild child;
+                child.parent = level[i].root;
+                child.distance = it.first;
+                child.node = std::make_unique<BKTreeNode>();
+                child.node.get()->setWord(*it.second[0]);
+
+                PendingSubtree subtree;
+                subtree.root = child.node.get();
+                subtree.pivot = *it.second[0];
+                subtree.words.assign(it.second.begin() + 1, it.second.end());
+                children.push_back(std::move(child));
+
+                if(subtree.words.size() > BK_TREE_SEQUENTIAL_BUILD_SIZE)
+                {
+                    next.push_back(std::move(subtree));
+                }
+                else if(!subtree.words.empty())
+                {
+                    small.push_back(std::move(subtree));
+                }
+            }
+        }
+
+        level = std::move(next);
+    }
+
+    // Start with the largest subtrees for a better balance between the threads
+    std::stable_sort(small.begin(), small.end(),
+                     [](const PendingSubtree& a, const PendingSubtree& b)
+                     {
+                         return a.words.size() > b.words.size();
+                     });
+
+    // Numbers of nodes added to the small subtrees, repeated words add none
+    std::vector<std::size_t> added(small.size(), 0);
+
+    Parallel::forEach(small.size(), threads,
+                      [&](std::size_t i)
+                      {
+                          bool restored;
+
+                          for(const std::string* word : small[i].words)
+                          {
+                              added[i] += small[i].root->insert(*word, restored) ? 1 : 0;
+                          }
+                      });
+
+    this->node_count = 1 + children.size();
+
+    for(std::size_t count : added)
+    {
+        this->node_count += count;
+    }
+
+    // Children are created after their parents, so the deepest ones are attached first
+    for(auto it = children.rbegin(); it != children.rend(); it++)
+    {
+        it->parent->setChild(it->distance, std::move(it->node));
+    }
+}
+
+/**
+ * @brief Get the root node
+ *
+ * @return Root node (nullptr if the tree is empty)
+ */
+const BKTreeNode* BKTree::getRoot() const
+{
+    return this->root.get();
+}
+
+/**
+ * @brief Get the seed of the random insertion order the tree was built with
+ *
+ * @return Seed
+ */
+std::uint64_t BKTree::getSeed() const
+{
+    return this->seed;
+}
+
+/**
+ * @brief Set the seed of the random insertion order the tree was built with
+ *
+ * @param seed Seed
+ */
+void BKTree::setSeed(std::uint64_t seed)
+{
+    this->seed = seed;
+}
+
+/**
+ * @brief Get the estimated cost of a query
+ *
+ * @return Average number of visited nodes, 0 if it is unknown
+ */
+double BKTree::getCost() const
+{
+    return this->cost;
+}
+
+/**
+ * @brief Set the estimated cost of a query
+ *
+ * @param cost Average number of visited nodes
+ */
+void BKTree::setCost(double cost)
+{
+    this->cost = cost;
+}
+
+/**
+ * @brief Get the number of nodes, including the deleted ones
+ *
+ * @return Number of nodes
+ */
+std::size_t BKTree::getNodeCount() const
+{
+    return this->node_count;
+}
+
+/**
+ * @brief Get the number of nodes with a deleted word
+ *
+ * @return Number of deleted nodes
+ */
+std::size_t BKTree::getDeadCount() const
+{
+    return this->dead_count;
+}
+
+/**
+ * @brief Get the fraction of nodes with a deleted word
+ *
+ * @return Fraction of deleted nodes (0 if the tree is empty)
+ */
+double BKTree::getDeadFraction() const
+{
+    if(this->node_count == 0)
+    {
+        return 0.0;
+    }
+
+    return static_cast<double>(this->dead_count) / static_cast<double>(this->node_count);
+}
+
+/**
+ * @brief Rebuild the topmost subtrees below the root whose fraction of deleted nodes
+ * exceeds the threshold from their remaining words. The tree is not modified, the new
+ * subtrees are attached by replaceSubtrees(), so they can be built while the tree is read
+ *
+ * @param threshold Fraction of deleted nodes
+ * @param threads Number of threads (0 means one per hardware thread)
+ * @return Rebuilt subtrees
+ */
+std::vector<BKTree::SubtreeRebuild> BKTree::rebuildSubtrees(double threshold,
+                                                            unsigned int threads) const
+{
+    std::vector<SubtreeRebuild> rebuilds;
+    std::vector<const BKTreeNode*> sources;
+
+    if(this->root == nullptr)
+    {
+        return rebuilds;
+    }
+
+    std::vector<int> path;
+    std::size_t node_count = 0;
+    std::size_t dead_count = 0;
+    findDeadSubtrees(this->root.get(), threshold, path, rebuilds, sources, node_count,
+                     dead_count);
+
+    // Every word of a subtree has the same distance to the parent of the subtree,
+    // so any of them can be the root of the rebuilt subtree
+    Parallel::forEach(rebuilds.size(), threads,
+                      [&](std::size_t i)
+                      {
+                          std::vector<std::string> words;
+                          collectWords(sources[i], words);
+
+                          BKTree subtree;
+                          subtree.build(words, 1);
+                          rebuilds[i].subtree = std::move(subtree.root);
+                      });
+
+    return rebuilds;
+}
+
+/**
+ * @brief Replace subtrees by the ones rebuilt by rebuildSubtrees(). The tree must not
+ * be modified in between
+ *
+ * @param rebuilds Rebuilt subtrees (moved into the tree)
+ * @return Number of removed deleted nodes
+ */
+std::size_t BKTree::replaceSubtrees(std::vector<SubtreeRebuild>& rebuilds)
+{
+    std::size_t removed = 0;
+
+    for(SubtreeRebuild& rebuild : rebuilds)
+    {
+        BKTreeNode* parent = this->root.get();
+
+        for(std::size_t i = 0; parent != nullptr && i + 1 < rebuild.path.size(); i++)
+        {
+            parent = parent->getChild(rebuild.path[i]);
+        }
+
+        if(parent == nullptr || rebuild.path.empty() || !parent->hasChild(rebuild.path.back()))
+        {
+            throw std::runtime_error("BK-tree was modified after the subtrees were rebuilt");
+        }
+
+        if(rebuild.subtree != nullptr)
+        {
+            parent->setChild(rebuild.path.back(), std::move(rebuild.subtree));
+        }
+        else
+        {
+            parent->removeChild(rebuild.path.back());
+        }
+
+        this->node_count -= rebuild.dead_count;
+        this->dead_count -= rebuild.dead_count;
+        removed += rebuild.dead_count;
+    }
+
+    return removed;
+}
+
+/**
+ * @brief Rebuild the topmost subtrees below the root whose fraction of deleted nodes
+ * exceeds the threshold. The root stays as a pivot even if its word is deleted
+ *
+ * @param threshold Fraction of deleted nodes
+ * @param threads Number of threads (0 means one per hardware thread)
+ * @return Number of removed deleted nodes
+ */
+std::size_t BKTree::compact(double threshold, unsigned int threads)
+{
+    std::vector<SubtreeRebuild> rebuilds = this->rebuildSubtrees(threshold, threads);
+    return this->replaceSubtrees(rebuilds);
+}
+
+/**
+ * @brief Estimate the cost of queries as the average number of nodes they visit
+ *
+ * @param queries Sample of queries
+ * @param tolerance Tolerance value (max edit distance)
+ * @return Average number of visited nodes (0 if there are no queries)
+ */
+double BKTree::estimateCost(const std::vector<std::string>& queries, unsigned int tolerance) const
+{
+    if(this->root == nullptr || queries.empty())
+    {
+        return 0.0;
+    }
+
+    std::size_t visits = 0;
+
+    for(const std::string& query : queries)
+    {
+        visits += this->root.get()->countVisits(EditDistance::CompiledQuery(query), tolerance,
+                                                EditDistance::threadWorkspace());
+    }
+
+    return static_cast<double>(visits) / static_cast<double>(queries.size());
 }
 
 /**
@@ -58,10 +600,150 @@ void BKTree::insert(const std::string& word)
 std::vector<std::string> BKTree::find(const std::string& query, unsigned int tolerance) const
 {
     std::vector<std::string> results;
-    this->root.get()->find(query, tolerance, results);
+
+    // The query is compiled once and reused for every node of the tree
+    this->root.get()->find(EditDistance::CompiledQuery(query), tolerance, results,
+                           EditDistance::threadWorkspace());
+    return results;
+}
+
+/**
+ * @brief Find all words similar to the query within the tolerance value and collect
+ * the statistics of the query. The counters are only updated if the library is built
+ * with BK_TREE_QUERY_STATS defined
+ *
+ * @param query Query
+ * @param tolerance Tolerance value (max edit distance)
+ * @param stats Statistics of the query
+ * @return A list of matching words
+ */
+std::vector<std::string> BKTree::find(const std::string& query, unsigned int tolerance,
+                                      QueryStats& stats) const
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    stats = QueryStats();
+    std::vector<std::string> results;
+
+    if(this->root != nullptr)
+    {
+        this->root.get()->find(EditDistance::CompiledQuery(query), tolerance, results,
+                               EditDistance::threadWorkspace(), &stats);
+    }
+
+    stats.wall_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    return results;
+}
+
+/**
+ * @brief Find the k words closest to the query within the tolerance value.
+ * If several words are at the distance of the k-th closest word, the ones
+ * reached first by the traversal are returned
+ *
+ * @param query Query
+ * @param k Maximum number of words to find
+ * @param max_tolerance Tolerance value (max edit distance)
+ * @return Up to k pairs of edit distance and word, sorted by edit distance and word
+ */
+std::vector<std::pair<int, std::string>> BKTree::findNearest(const std::string& query,
+                                                             std::size_t k,
+                                                             unsigned int max_tolerance) const
+{
+    std::vector<std::pair<int, std::string>> results;
+
+    if(this->root != nullptr)
+    {
+        this->root.get()->findNearest(EditDistance::CompiledQuery(query), k, max_tolerance,
+                                      results, EditDistance::threadWorkspace());
+    }
+
+    return results;
+}
+
+/**
+ * @brief Find all words similar to each of the queries within the tolerance value.
+ * Queries are distributed over a work-stealing pool of threads
+ *
+ * @param queries Queries
+ * @param tolerance Tolerance value (max edit distance)
+ * @param threads Number of threads (0 means one per hardware thread)
+ * @return Lists of matching words in the order of the queries
+ */
+std::vector<std::vector<std::string>> BKTree::findMany(const std::vector<std::string>& queries,
+                                                       unsigned int tolerance,
+                                                       unsigned int threads) const
+{
+    std::vector<std::vector<std::string>> results(queries.size());
+
+    if(this->root == nullptr)
+    {
+        return results;
+    }
+
+    // Every query writes only to its own slot, so no synchronization is needed
+    Parallel::forEach(queries.size(), threads,
+                      [&](std::size_t i)
+                      {
+                          this->root.get()->find(EditDistance::CompiledQuery(queries[i]),
+                                                 tolerance, results[i],
+                                                 EditDistance::threadWorkspace());
+                      });
+
     return results;
 }
 
+/**
+ * @brief Find all words similar to each of the queries within the tolerance value.
+ * Queries are distributed over a work-stealing pool of threads and the results are
+ * passed to the callback as soon as they are found. Calls of the callback never overlap,
+ * but come in no particular order
+ *
+ * @param queries Queries
+ * @param tolerance Tolerance value (max edit distance)
+ * @param threads Number of threads (0 means one per hardware thread)
+ * @param callback Function that receives the index of a query and its matching words
+ */
+void BKTree::findMany(
+    const std::vector<std::string>& queries, unsigned int tolerance, unsigned int threads,
+    const std::function<void(std::size_t, std::vector<std::string>&)>& callback) const
+{
+    std::mutex callback_mutex;
+
+    Parallel::forEach(queries.size(), threads,
+                      [&](std::size_t i)
+                      {
+                          std::vector<std::string> results;
+
+                          if(this->root != nullptr)
+                          {
+                              this->root.get()->find(EditDistance::CompiledQuery(queries[i]),
+                                                     tolerance, results,
+                                                     EditDistance::threadWorkspace());
+                          }
+
+                          std::lock_guard<std::mutex> lock(callback_mutex);
+                          callback(i, results);
+                      });
+}
+
+/**
+ * @brief Get the statistics of the shape of the tree
+ *
+ * @return Node count, depth histogram and fanout histogram
+ */
+TreeStats BKTree::stats() const
+{
+    TreeStats stats;
+
+    if(this->root != nullptr)
+    {
+        this->root.get()->collectStats(stats);
+    }
+
+    return stats;
+}
+
 /**
  * @brief Serialize an entire BK-tree
  *
@@ -74,16 +756,177 @@ void BKTree::serialize(std::ostream& os) const
         return;
     }
 
+    // Write the header: magic bytes, the version of the format, the seed and the cost
+    unsigned int version = BK_TREE_FORMAT_VERSION;
+    std::uint64_t seed = this->seed;
+    double cost = this->cost;
+    os.write(BK_TREE_MAGIC, sizeof(BK_TREE_MAGIC));
+    os.write(reinterpret_cast<char*>(&version), sizeof(version));
+    os.write(reinterpret_cast<char*>(&seed), sizeof(seed));
+    os.write(reinterpret_cast<char*>(&cost), sizeof(cost));
+
     this->root.get()->serialize(os);
 }
 
 /**
- * @brief Deserialize an entire BK-tree
+ * @brief Deserialize an entire BK-tree. Files in the original format without
+ * a header are also supported. The tree is only replaced if the data is valid
  *
  * @param is Input stream
  */
 void BKTree::deserialize(std::istream& is)
 {
-    this->root = std::make_unique<BKTreeNode>();
-    this->root.get()->deserialize(is);
+    ByteReader::parseStream(is, [this](ByteReader& reader) { this->deserialize(reader); });
+}
+
+/**
+ * @brief Deserialize an entire BK-tree from memory. Files in the original format
+ * without a header are also supported. The tree is only replaced if the data is valid
+ *
+ * @param reader Reader of the serialized data
+ */
+void BKTree::deserialize(ByteReader& reader)
+{
+    // Files without a header start with the length of the root word. The magic bytes
+    // read as a length would exceed any real word, so both formats can be told apart
+    unsigned int version = 0;
+
+    // The tree is read aside, so a corrupt file leaves the current one intact
+    BKTree tree;
+
+    if(reader.startsWith(BK_TREE_MAGIC, sizeof(BK_TREE_MAGIC)))
+    {
+        reader.read(sizeof(BK_TREE_MAGIC));
+        version = reader.readValue<unsigned int>();
+
+        if(version > BK_TREE_FORMAT_VERSION)
+        {
+            throw std::runtime_error("unsupported BK-tree format version " +
+                                     std::to_string(version));
+        }
+
+        if(version >= 2)
+        {
+            tree.seed = reader.readValue<std::uint64_t>();
+            tree.cost = reader.readValue<double>();
+        }
+    }
+
+    tree.root = std::make_unique<BKTreeNode>();
+    tree.root.get()->deserialize(reader, version);
+
+    TreeStats stats = tree.stats();
+    tree.node_count = stats.node_count;
+    tree.dead_count = stats.dead_count;
+
+    *this = std::move(tree);
+}
+
+/**
+ * @brief Serialize a delta segment with words to add to a serialized BK-tree.
+ * Segments can be appended to the same delta file one after another
+ *
+ * @param os Output stream
+ * @param words Words to add
+ */
+void BKTree::serializeDelta(std::ostream& os, const std::vector<std::string>& words)
+{
+    // Write the header: magic bytes, the version of the format and the number of words
+    unsigned int version = BK_TREE_DELTA_VERSION;
+    unsigned int word_count = static_cast<unsigned int>(words.size());
+    os.write(BK_TREE_DELTA_MAGIC, sizeof(BK_TREE_DELTA_MAGIC));
+    os.write(reinterpret_cast<char*>(&version), sizeof(version));
+    os.write(reinterpret_cast<char*>(&word_count), sizeof(word_count));
+
+    // Write every word after its length
+    for(const std::string& word : words)
+    {
+        unsigned int word_len = static_cast<unsigned int>(word.size());
+        os.write(reinterpret_cast<char*>(&word_len), sizeof(word_len));
+        os.write(word.data(), word_len);
+    }
+}
+
+/**
+ * @brief Insert the words of all delta segments until the end of the stream.
+ * Words that are already in the tree are skipped. The tree is only changed
+ * if the whole delta is valid
+ *
+ * @param is Input stream
+ * @return Number of inserted words
+ */
+std::size_t BKTree::applyDelta(std::istream& is)
+{
+    std::size_t inserted = 0;
+    ByteReader::parseStream(is, [&](ByteReader& reader) { inserted = this->applyDelta(reader); });
+    return inserted;
+}
+
+/**
+ * @brief Insert the words of all delta segments until the end of the data.
+ * Words that are already in the tree are skipped. The tree is only changed
+ * if the whole delta is valid
+ *
+ * @param reader Reader of the serialized data
+ * @return Number of inserted words
+ */
+std::size_t BKTree::applyDelta(ByteReader& reader)
+{
+    // All segments are read before the first word is inserted
+    std::vector<std::string> words;
+
+    // Every segment starts with the magic bytes, the end of the data ends the delta
+    while(reader.remaining() > 0)
+    {
+        if(!reader.startsWith(BK_TREE_DELTA_MAGIC, sizeof(BK_TREE_DELTA_MAGIC)))
+        {
+            throw std::runtime_error("invalid BK-tree delta data");
+        }
+
+        reader.read(sizeof(BK_TREE_DELTA_MAGIC));
+        unsigned int version = reader.readValue<unsigned int>();
+
+        if(version > BK_TREE_DELTA_VERSION)
+        {
+            throw std::runtime_error("unsupported BK-tree delta format version " +
+                                     std::to_string(version));
+        }
+
+        // Every word takes at least four bytes for its length, which bounds the count
+        // of a corrupt segment
+        unsigned int word_count = reader.readValue<unsigned int>();
+
+        if(word_count > reader.remaining() / sizeof(unsigned int))
+        {
+            throw std::runtime_error("invalid BK-tree delta data");
+        }
+
+        for(unsigned int i = 0; i < word_count; i++)
+        {
+            unsigned int word_len = reader.readValue<unsigned int>();
+
+            if(word_len > BK_TREE_MAX_WORD_LENGTH || word_len > reader.remaining())
+            {
+                throw std::runtime_error("invalid BK-tree delta data");
+            }
+
+            std::string word(reader.read(word_len), word_len);
+
+            if(!EditDistance::isValidString(word))
+            {
+                throw std::runtime_error("invalid BK-tree delta data");
+            }
+
+            words.push_back(std::move(word));
+        }
+    }
+
+    std::size_t inserted = 0;
+
+    for(const std::string& word : words)
+    {
+        inserted += this->insert(word) ? 1 : 0;
+    }
+
+    return inserted;
 }
@@ -21,21 +21,77 @@
 #define BK_TREE_H_INCLUDED
 
 #include "bk_tree_node.h"
+#include "bk_tree_stats.h"
+#include "byte_reader.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <istream>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 class BKTree
 {
+public:
+    /**
+     * @brief A rebuilt subtree that replaces a subtree with many deleted words
+     *
+     */
+    struct SubtreeRebuild
+    {
+        /**
+         * @brief Edit distances of the edges from the root to the replaced subtree
+         *
+         */
+        std::vector<int> path;
+        /**
+         * @brief Root of the rebuilt subtree (nullptr if all words of the subtree are deleted)
+         *
+         */
+        std::unique_ptr<BKTreeNode> subtree;
+        /**
+         * @brief Number of nodes of the replaced subtree
+         *
+         */
+        std::size_t node_count = 0;
+        /**
+         * @brief Number of deleted nodes of the replaced subtree
+         *
+         */
+        std::size_t dead_count = 0;
+    };
+
 private:
     /**
      * @brief Root node
      *
      */
     std::unique_ptr<BKTreeNode> root;
+    /**
+     * @brief Seed of the random insertion order the tree was built with
+     *
+     */
+    std::uint64_t seed;
+    /**
+     * @brief Estimated cost of a query (average number of visited nodes),
+     * 0 if it is unknown
+     *
+     */
+    double cost;
+    /**
+     * @brief Number of nodes
+     *
+     */
+    std::size_t node_count;
+    /**
+     * @brief Number of nodes with a deleted word (tombstones)
+     *
+     */
+    std::size_t dead_count;
 
 public:
     /**
@@ -45,11 +101,121 @@ public:
     BKTree();
 
     /**
-     * @brief Insert a word into a tree
+     * @brief Insert a word into a tree. A word that is already in the tree is not inserted again
      *
      * @param word A word to insert
+     * @return true if the word is inserted, false if it is already in the tree
+     */
+    bool insert(const std::string& word);
+
+    /**
+     * @brief Delete a word. Its node stays in the tree as a pivot of the search
+     * (tombstone), but the word is never reported
+     *
+     * @param word A word to delete
+     * @return true if the word is deleted, false if it is not in the tree
+     */
+    bool remove(const std::string& word);
+
+    /**
+     * @brief Build a tree from a list of words, replacing the current contents. The words
+     * are recursively partitioned by their distance to the root of their subtree, every level
+     * of the partitioning runs in parallel. Subtrees with few words are built by sequential
+     * insertion, each on its own thread. The result is the same as inserting the words one by one
+     *
+     * @param words Words in the order of insertion
+     * @param threads Number of threads (0 means one per hardware thread)
+     */
+    void build(const std::vector<std::string>& words, unsigned int threads = 0);
+
+    /**
+     * @brief Get the root node
+     *
+     * @return Root node (nullptr if the tree is empty)
+     */
+    const BKTreeNode* getRoot() const;
+
+    /**
+     * @brief Get the seed of the random insertion order the tree was built with
+     *
+     * @return Seed
+     */
+    std::uint64_t getSeed() const;
+    /**
+     * @brief Set the seed of the random insertion order the tree was built with
+     *
+     * @param seed Seed
+     */
+    void setSeed(std::uint64_t seed);
+
+    /**
+     * @brief Get the estimated cost of a query
+     *
+     * @return Average number of visited nodes, 0 if it is unknown
+     */
+    double getCost() const;
+    /**
+     * @brief Set the estimated cost of a query
+     *
+     * @param cost Average number of visited nodes
+     */
+    void setCost(double cost);
+
+    /**
+     * @brief Get the number of nodes, including the deleted ones
+     *
+     * @return Number of nodes
+     */
+    std::size_t getNodeCount() const;
+    /**
+     * @brief Get the number of nodes with a deleted word
+     *
+     * @return Number of deleted nodes
+     */
+    std::size_t getDeadCount() const;
+    /**
+     * @brief Get the fraction of nodes with a deleted word
+     *
+     * @return Fraction of deleted nodes (0 if the tree is empty)
+     */
+    double getDeadFraction() const;
+
+    /**
+     * @brief Rebuild the topmost subtrees below the root whose fraction of deleted nodes
+     * exceeds the threshold from their remaining words. The tree is not modified, the new
+     * subtrees are attached by replaceSubtrees(), so they can be built while the tree is read
+     *
+     * @param threshold Fraction of deleted nodes
+     * @param threads Number of threads (0 means one per hardware thread)
+     * @return Rebuilt subtrees
+     */
+    std::vector<SubtreeRebuild> rebuildSubtrees(double threshold, unsigned int threads = 0) const;
+    /**
+     * @brief Replace subtrees by the ones rebuilt by rebuildSubtrees(). The tree must not
+     * be modified in between
+     *
+     * @param rebuilds Rebuilt subtrees (moved into the tree)
+     * @return Number of removed deleted nodes
+     */
+    std::size_t replaceSubtrees(std::vector<SubtreeRebuild>& rebuilds);
+    /**
+     * @brief Rebuild the topmost subtrees below the root whose fraction of deleted nodes
+     * exceeds the threshold. The root stays as a pivot even if its word is deleted
+     *
+     * @param threshold Fraction of deleted nodes
+     * @param threads Number of threads (0 means one per hardware thread)
+     * @return Number of removed deleted nodes
      */
-    void insert(const std::string& word);
+    std::size_t compact(double threshold, unsigned int threads = 0);
+
+    /**
+     * @brief Estimate the cost of queries as the average number of nodes they visit
+     *
+     * @param queries Sample of queries
+     * @param tolerance Tolerance value (max edit distance)
+     * @return Average number of visited nodes (0 if there are no queries)
+     */
+    double estimateCost(const std::vector<std::string>& queries, unsigned int tolerance = 2) const;
 
     /**
      * @brief Find all words similar to the query within the tolerance value
@@ -59,6 +225,65 @@ public:
      * @return A list of matching words
      */
     std::vector<std::string> find(const std::string& query, unsigned int tolerance = 2) const;
+    /**
+     * @brief Find all words similar to the query within the tolerance value and collect
+     * the statistics of the query. The counters are only updated if the library is built
+     * with BK_TREE_QUERY_STATS defined
+     *
+     * @param query Query
+     * @param tolerance Tolerance value (max edit distance)
+     * @param stats Statistics of the query
+     * @return A list of matching words
+     */
+    std::vector<std::string> find(const std::string& query, unsigned int tolerance,
+                                  QueryStats& stats) const;
+
+    /**
+     * @brief Find the k words closest to the query within the tolerance value.
+     * If several words are at the distance of the k-th closest word, the ones
+     * reached first by the traversal are returned
+     *
+     * @param query Query
+     * @param k Maximum number of words to find
+     * @param max_tolerance Tolerance value (max edit distance)
+     * @return Up to k pairs of edit distance and word, sorted by edit distance and word
+     */
+    std::vector<std::pair<int, std::string>> findNearest(const std::string& query, std::size_t k,
+                                                         unsigned int max_tolerance = 2) const;
+
+    /**
+     * @brief Find all words similar to each of the queries within the tolerance value.
+     * Queries are distributed over a work-stealing pool of threads
+     *
+     * @param queries Queries
+     * @param tolerance Tolerance value (max edit distance)
+     * @param threads Number of threads (0 means one per hardware thread)
+     * @return Lists of matching words in the order of the queries
+     */
+    std::vector<std::vector<std::string>> findMany(const std::vector<std::string>& queries,
+                                                   unsigned int tolerance = 2,
+                                                   unsigned int threads = 0) const;
+    /**
+     * @brief Find all words similar to each of the queries within the tolerance value.
+     * Queries are distributed over a work-stealing pool of threads and the results are
+     * passed to the callback as soon as they are found. Calls of the callback never overlap,
+     * but come in no particular order
+     *
+     * @param queries Queries
+     * @param tolerance Tolerance value (max edit distance)
+     * @param threads Number of threads (0 means one per hardware thread)
+     * @param callback Function that receives the index of a query and its matching words
+     */
+    void findMany(
+        const std::vector<std::string>& queries, unsigned int tolerance, unsigned int threads,
+        const std::function<void(std::size_t, std::vector<std::string>&)>& callback) const;
+
+    /**
+     * @brief Get the statistics of the shape of the tree
+     *
+     * @return Node count, depth histogram and fanout histogram
+     */
+    TreeStats stats() const;
 
     /**
      * @brief Serialize an entire BK-tree
@@ -68,11 +293,49 @@ public:
     void serialize(std::ostream& os) const;
 
     /**
-     * @brief Deserialize an entire BK-tree
+     * @brief Deserialize an entire BK-tree. Files in the original format without
+     * a header are also supported. The tree is only replaced if the data is valid
      *
      * @param is Input stream
      */
     void deserialize(std::istream& is);
+
+    /**
+     * @brief Deserialize an entire BK-tree from memory. Files in the original format
+     * without a header are also supported. The tree is only replaced if the data is valid
+     *
+     * @param reader Reader of the serialized data
+     */
+    void deserialize(ByteReader& reader);
+
+    /**
+     * @brief Serialize a delta segment with words to add to a serialized BK-tree.
+     * Segments can be appended to the same delta file one after another
+     *
+     * @param os Output stream
+     * @param words Words to add
+     */
+    static void serializeDelta(std::ostream& os, const std::vector<std::string>& words);
+
+    /**
+     * @brief Insert the words of all delta segments until the end of the stream.
+     * Words that are already in the tree are skipped. The tree is only changed
+     * if the whole delta is valid
+     *
+     * @param is Input stream
+     * @return Number of inserted words
+     */
+    std::size_t applyDelta(std::istream& is);
+
+    /**
+     * @brief Insert the words of all delta segments until the end of the data.
+     * Words that are already in the tree are skipped. The tree is only changed
+     * if the whole delta is valid
+     *
+     * @param reader Reader of the serialized data
+     * @return Number of inserted words
+     */
+    std::size_t applyDelta(ByteReader& reader);
 };
 
 #endif // BK_TREE_H_INCLUDED
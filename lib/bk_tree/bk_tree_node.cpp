@@ -19,14 +19,31 @@
 
 #include "bk_tree_node.h"
 #include "edit_distance.h"
+#include "byte_reader.h"
+#include "varint.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
 #include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 /**
  * @brief Default constructor
  *
  */
-BKTreeNode::BKTreeNode() : word(), children() {}
+BKTreeNode::BKTreeNode() :
+    word(), children(), max_child_distance(0), min_length(0), max_length(0), deleted(false)
+{
+}
 
 /**
  * @brief Get the word of the current node
@@ -46,6 +63,33 @@ std::string BKTreeNode::getWord() const
 void BKTreeNode::setWord(const std::string& word)
 {
     this->word = word;
+    this->min_length = static_cast<int>(word.length());
+    this->max_length = static_cast<int>(word.length());
+
+    for(const auto& it : this->children)
+    {
+        this->extendLengths(it.second.get()->min_length, it.second.get()->max_length);
+    }
+}
+
+/**
+ * @brief Check if the word of the current node is deleted
+ *
+ * @return true if the word is deleted, false otherwise
+ */
+bool BKTreeNode::isDeleted() const
+{
+    return this->deleted;
+}
+
+/**
+ * @brief Set whether the word of the current node is deleted
+ *
+ * @param deleted Whether the word is deleted
+ */
+void BKTreeNode::setDeleted(bool deleted)
+{
+    this->deleted = deleted;
 }
 
 /**
@@ -73,6 +117,55 @@ BKTreeNode* BKTreeNode::getChild(int distance) const
     return (it != this->children.end()) ? it->second.get() : nullptr;
 }
 
+/**
+ * @brief Get the edit distances of all child nodes
+ *
+ * @return Edit distances of the child nodes in ascending order
+ */
+std::vector<int> BKTreeNode::getChildDistances() const
+{
+    std::vector<int> distances;
+    distances.reserve(this->children.size());
+
+    for(const auto& it : this->children)
+    {
+        distances.push_back(it.first);
+    }
+
+    std::sort(distances.begin(), distances.end());
+    return distances;
+}
+
+/**
+ * @brief Get the largest edit distance among the children of the current node
+ *
+ * @return The largest edit distance of a child node (0 if the node has no children)
+ */
+int BKTreeNode::getMaxChildDistance() const
+{
+    return this->max_child_distance;
+}
+
+/**
+ * @brief Get the shortest word length in the subtree of the current node
+ *
+ * @return The shortest word length
+ */
+int BKTreeNode::getMinLength() const
+{
+    return this->min_length;
+}
+
+/**
+ * @brief Get the longest word length in the subtree of the current node
+ *
+ * @return The longest word length
+ */
+int BKTreeNode::getMaxLength() const
+{
+    return this->max_length;
+}
+
 /**
  * @brief Add a new child node
  *
@@ -85,30 +178,107 @@ void BKTreeNode::addChild(int distance, const std::string& word)
     {
         this->children[distance] = std::make_unique<BKTreeNode>();
         this->children[distance].get()->setWord(word);
+        this->max_child_distance = std::max(this->max_child_distance, distance);
+        this->extendLengths(static_cast<int>(word.length()), static_cast<int>(word.length()));
     }
 }
 
 /**
- * @brief Insert a word
+ * @brief Attach an existing subtree as a child node
+ *
+ * @param distance Edit distance
+ * @param child Root of the subtree
+ */
+void BKTreeNode::setChild(int distance, std::unique_ptr<BKTreeNode> child)
+{
+    this->extendLengths(child.get()->min_length, child.get()->max_length);
+    this->children[distance] = std::move(child);
+    this->max_child_distance = std::max(this->max_child_distance, distance);
+}
+
+/**
+ * @brief Remove a child node with its subtree. The range of word lengths and the largest
+ * child distance are kept, they stay valid bounds for the remaining children
+ *
+ * @param distance Edit distance of the child node
+ */
+void BKTreeNode::removeChild(int distance)
+{
+    this->children.erase(distance);
+}
+
+/**
+ * @brief Insert a word. A deleted node with the same word is restored instead,
+ * nothing is changed if a node with the same word is not deleted
  *
  * @param word A word to insert
+ * @param restored Set to true if a deleted node is restored, false otherwise
+ * @return true if the word is inserted or restored, false if it is already in the subtree
  */
-void BKTreeNode::insert(const std::string& word)
+bool BKTreeNode::insert(const std::string& word, bool& restored)
 {
     BKTreeNode* node = this;
+    EditDistance::Workspace& workspace = EditDistance::threadWorkspace();
+
+    int length = static_cast<int>(word.length());
+    restored = false;
 
     while(true)
     {
-        int distance = EditDistance::editDistance(word, node->getWord());
+        // The word ends up in the subtree of every node on the path
+        node->extendLengths(length, length);
+
+        int distance = EditDistance::editDistance(word, node->word, workspace);
+
+        // Every word has a single node, so a repeated word never gets a second one
+        if(distance == 0 && node->word == word)
+        {
+            if(!node->deleted)
+            {
+                return false;
+            }
+
+            node->deleted = false;
+            restored = true;
+            return true;
+        }
 
         if(!node->hasChild(distance))
         {
             node->addChild(distance, word);
-            return;
+            return true;
+        }
+
+        node = node->getChild(distance);
+    }
+}
+
+/**
+ * @brief Delete a word by marking its node as a tombstone
+ *
+ * @param word A word to delete
+ * @return true if the word is deleted, false if it is not in the subtree
+ */
+bool BKTreeNode::remove(const std::string& word)
+{
+    BKTreeNode* node = this;
+    EditDistance::Workspace& workspace = EditDistance::threadWorkspace();
+
+    // The word can only be in the child at its distance to every node on the path
+    while(node != nullptr)
+    {
+        int distance = EditDistance::editDistance(word, node->word, workspace);
+
+        if(distance == 0 && !node->deleted && node->word == word)
+        {
+            node->deleted = true;
+            return true;
         }
 
         node = node->getChild(distance);
     }
+
+    return false;
 }
 
 /**
@@ -121,9 +291,42 @@ void BKTreeNode::insert(const std::string& word)
 void BKTreeNode::find(const std::string& query, unsigned int tolerance,
                       std::vector<std::string>& results) const
 {
-    int distance = EditDistance::editDistance(query, this->word);
+    this->find(EditDistance::CompiledQuery(query), tolerance, results,
+               EditDistance::threadWorkspace());
+}
 
-    if(distance <= tolerance)
+/**
+ * @brief Find all words similar to the query within the tolerance value
+ *
+ * @param query Compiled query
+ * @param tolerance Tolerance value (max edit distance)
+ * @param results A collection with results to pass
+ * @param workspace Scratch memory for edit distance calculations
+ * @param stats Statistics of the query to update (nullptr if not needed)
+ * @param depth Depth of the current node in the tree
+ */
+void BKTreeNode::find(const EditDistance::CompiledQuery& query, unsigned int tolerance,
+                      std::vector<std::string>& results, EditDistance::Workspace& workspace,
+                      QueryStats* stats, std::size_t depth) const
+{
+    // Skip the subtree if none of its words is close enough in length
+    if(this->lengthBound(static_cast<int>(query.getText().length())) > static_cast<int>(tolerance))
+    {
+        BK_TREE_COUNT(stats, stats->length_pruned_subtrees++);
+        return;
+    }
+
+    BK_TREE_COUNT(stats, stats->nodes_visited++);
+    BK_TREE_COUNT(stats, stats->max_depth = std::max(stats->max_depth, depth));
+
+    // Children are only visited if their distance is within the tolerance of the distance
+    // to this node, so the exact distance is not needed once it exceeds this cap
+    int cap = static_cast<int>(tolerance) + this->max_child_distance;
+    int distance = EditDistance::editDistanceBounded(query, this->word, cap, workspace);
+
+    BK_TREE_COUNT(stats, stats->distance_calls++);
+
+    if(distance <= tolerance && !this->deleted)
     {
         results.push_back(this->word);
     }
@@ -135,69 +338,378 @@ void BKTreeNode::find(const std::string& query, unsigned int tolerance,
     {
         if(it.first >= min_dist && it.first <= max_dist)
         {
-            it.second.get()->find(query, tolerance, results);
+            it.second.get()->find(query, tolerance, results, workspace, stats, depth + 1);
+        }
+        else
+        {
+            BK_TREE_COUNT(stats, stats->pruned_subtrees++);
         }
     }
 }
 
 /**
- * @brief Seerialize current node
+ * @brief Find the words closest to the query using a best-first traversal of the subtree.
+ * Subtrees are visited in the order of the lower bound of their distances, and the
+ * tolerance shrinks as soon as k words are found, so only strictly closer words are
+ * searched for after that
  *
- * @param os Output stream
+ * @param query Compiled query
+ * @param k Maximum number of words to find
+ * @param max_tolerance Tolerance value (max edit distance)
+ * @param results Up to k pairs of edit distance and word, sorted by edit distance and word
+ * @param workspace Scratch memory for edit distance calculations
+ */
+void BKTreeNode::findNearest(const EditDistance::CompiledQuery& query, std::size_t k,
+                             unsigned int max_tolerance,
+                             std::vector<std::pair<int, std::string>>& results,
+                             EditDistance::Workspace& workspace) const
+{
+    if(k == 0)
+    {
+        return;
+    }
+
+    // Ties are broken by the order in which nodes are queued and words are found,
+    // so the result does not depend on the addresses of the nodes
+    typedef std::tuple<int, std::size_t, const BKTreeNode*> Candidate;
+    typedef std::tuple<int, std::size_t, const std::string*> Match;
+
+    // Nodes to visit with the lower bound of the distances in their subtrees (closest first)
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> frontier;
+    // The closest words found so far (farthest and latest found first)
+    std::priority_queue<Match> nearest;
+
+    std::size_t queued = 0;
+    std::size_t found = 0;
+
+    int tolerance = static_cast<int>(max_tolerance);
+    int length = static_cast<int>(query.getText().length());
+    frontier.emplace(this->lengthBound(length), queued++, this);
+
+    while(!frontier.empty() && std::get<0>(frontier.top()) <= tolerance)
+    {
+        const BKTreeNode* node = std::get<2>(frontier.top());
+        frontier.pop();
+
+        int cap = tolerance + node->max_child_distance;
+        int distance = EditDistance::editDistanceBounded(query, node->word, cap, workspace);
+
+        if(distance <= tolerance && !node->deleted)
+        {
+            nearest.emplace(distance, found++, &node->word);
+
+            if(nearest.size() > k)
+            {
+                nearest.pop();
+            }
+
+            // Once k words are found, only strictly closer words can improve the result
+            if(nearest.size() == k)
+            {
+                tolerance = std::min(tolerance, std::get<0>(nearest.top()) - 1);
+            }
+        }
+
+        // By the triangle inequality, no word in the subtree of the child is closer
+        // than the difference between the distance to this node and the edge distance.
+        // The difference of the lengths is another lower bound
+        for(const auto& it : node->children)
+        {
+            int bound = std::max(std::abs(distance - it.first),
+                                 it.second.get()->lengthBound(length));
+
+            if(bound <= tolerance)
+            {
+                frontier.emplace(bound, queued++, it.second.get());
+            }
+        }
+    }
+
+    std::size_t first = results.size();
+
+    while(!nearest.empty())
+    {
+        results.emplace_back(std::get<0>(nearest.top()), *std::get<2>(nearest.top()));
+        nearest.pop();
+    }
+
+    std::sort(results.begin() + first, results.end());
+}
+
+/**
+ * @brief Count the nodes that find() visits for the query. Uses the same pruning as find()
+ *
+ * @param query Compiled query
+ * @param tolerance Tolerance value (max edit distance)
+ * @param workspace Scratch memory for edit distance calculations
+ * @return Number of nodes visited
  */
-void BKTreeNode::serialize(std::ostream& os) const
+std::size_t BKTreeNode::countVisits(const EditDistance::CompiledQuery& query,
+                                    unsigned int tolerance,
+                                    EditDistance::Workspace& workspace) const
 {
-    // Get the length of the word
-    unsigned int word_len = static_cast<unsigned int>(this->word.size());
+    if(this->lengthBound(static_cast<int>(query.getText().length())) > static_cast<int>(tolerance))
+    {
+        return 0;
+    }
 
-    // Write the length of the word and the word itself
-    os.write(reinterpret_cast<char*>(&word_len), sizeof(word_len));
-    os.write(&this->word[0], word_len);
+    int cap = static_cast<int>(tolerance) + this->max_child_distance;
+    int distance = EditDistance::editDistanceBounded(query, this->word, cap, workspace);
 
-    // Write the number of children the current node has
-    unsigned int num_children = static_cast<unsigned int>(this->children.size());
-    os.write(reinterpret_cast<char*>(&num_children), sizeof(num_children));
+    int min_dist = distance - tolerance;
+    int max_dist = distance + tolerance;
+    std::size_t visits = 1;
 
-    // Serialize children
-    for(const auto& it : children)
+    for(const auto& it : this->children)
     {
-        // Write the edit distance of the child node
-        unsigned short distance = static_cast<unsigned short>(it.first);
-        os.write(reinterpret_cast<char*>(&distance), sizeof(distance));
+        if(it.first >= min_dist && it.first <= max_dist)
+        {
+            visits += it.second.get()->countVisits(query, tolerance, workspace);
+        }
+    }
 
-        // Serialize the child node
-        it.second.get()->serialize(os);
+    return visits;
+}
+
+/**
+ * @brief Add the nodes of the subtree to the statistics of the tree shape
+ *
+ * @param stats Statistics of the tree shape
+ * @param depth Depth of the current node in the tree
+ */
+void BKTreeNode::collectStats(TreeStats& stats, std::size_t depth) const
+{
+    stats.node_count++;
+
+    if(this->deleted)
+    {
+        stats.dead_count++;
+    }
+
+    if(stats.depth_histogram.size() <= depth)
+    {
+        stats.depth_histogram.resize(depth + 1, 0);
+    }
+    stats.depth_histogram[depth]++;
+
+    if(stats.fanout_histogram.size() <= this->children.size())
+    {
+        stats.fanout_histogram.resize(this->children.size() + 1, 0);
+    }
+    stats.fanout_histogram[this->children.size()]++;
+
+    for(const auto& it : this->children)
+    {
+        it.second.get()->collectStats(stats, depth + 1);
+    }
+}
+
+/**
+ * @brief Serialize current node. The word is front-coded against the word of the parent
+ * and all numbers are LEB128 varints. The ranges of word lengths are not written,
+ * they are computed again while the children are read
+ *
+ * @param os Output stream
+ * @param parent_word Word of the parent node (empty for the root)
+ */
+void BKTreeNode::serialize(std::ostream& os, const std::string& parent_word) const
+{
+    // Write the length of the prefix shared with the parent word and the rest of the word
+    std::size_t shared = 0;
+    std::size_t max_shared = std::min(parent_word.size(), this->word.size());
+
+    while(shared < max_shared && parent_word[shared] == this->word[shared])
+    {
+        shared++;
+    }
+
+    Varint::write(os, shared);
+    Varint::write(os, this->word.size() - shared);
+    os.write(this->word.data() + shared, this->word.size() - shared);
+
+    // Write the number of children and whether the word is deleted in the lowest bit
+    Varint::write(os, (static_cast<std::uint64_t>(this->children.size()) << 1) |
+                          (this->deleted ? 1 : 0));
+
+    // Serialize children in the order of their edit distances
+    for(int distance : this->getChildDistances())
+    {
+        Varint::write(os, static_cast<std::uint64_t>(distance));
+        this->children.at(distance).get()->serialize(os, this->word);
     }
 }
 
 /**
  * @brief Deserialize current node
  *
- * @param is Input stream
+ * @param reader Reader of the serialized data
+ * @param version Version of the format (0 for files without a header)
+ * @param parent_word Word of the parent node (empty for the root)
  */
-void BKTreeNode::deserialize(std::istream& is)
+void BKTreeNode::deserialize(ByteReader& reader, unsigned int version,
+                             const std::string& parent_word)
 {
-    // Read the length of the word
-    unsigned int word_len;
-    is.read(reinterpret_cast<char*>(&word_len), sizeof(word_len));
+    if(version < 4)
+    {
+        this->deserializeFixed(reader, version);
+        return;
+    }
+
+    // Read the front-coded word
+    std::uint64_t shared = reader.readVarint();
+    std::uint64_t suffix_len = reader.readVarint();
+
+    if(shared > parent_word.size() || suffix_len > BK_TREE_MAX_WORD_LENGTH)
+    {
+        throw std::runtime_error("invalid BK-tree data");
+    }
+
+    // Characters are used as indices by the edit distance calculations, the shared
+    // prefix is already checked as part of the parent word
+    const char* suffix = reader.read(suffix_len);
+
+    if(!EditDistance::isValidString(std::string_view(suffix, suffix_len)))
+    {
+        throw std::runtime_error("invalid BK-tree data");
+    }
+
+    this->word.reserve(shared + suffix_len);
+    this->word.assign(parent_word, 0, shared);
+    this->word.append(suffix, suffix_len);
+
+    // The range of word lengths in the subtree is extended while the children are read
+    this->min_length = static_cast<int>(this->word.size());
+    this->max_length = static_cast<int>(this->word.size());
+
+    // Read the number of children and whether the word is deleted. Every child takes
+    // at least three bytes, which bounds the count of a corrupt node
+    std::uint64_t flags = reader.readVarint();
+    std::uint64_t num_children = flags >> 1;
+    this->deleted = (flags & 1) != 0;
+
+    if(num_children > reader.remaining() / 3)
+    {
+        throw std::runtime_error("invalid BK-tree data");
+    }
+
+    this->children.reserve(static_cast<std::size_t>(num_children));
+
+    // Deserialize child nodes
+    for(std::uint64_t i = 0; i < num_children; i++)
+    {
+        // Files written before repeated words were skipped by the insertion may have
+        // a child at distance 0 holding the same word
+        std::uint64_t distance = reader.readVarint();
+
+        if(distance > BK_TREE_MAX_WORD_LENGTH ||
+           this->children.count(static_cast<int>(distance)) != 0)
+        {
+            throw std::runtime_error("invalid BK-tree data");
+        }
 
+        std::unique_ptr<BKTreeNode>& child = this->children[static_cast<int>(distance)];
+        child = std::make_unique<BKTreeNode>();
+        child.get()->deserialize(reader, version, this->word);
+        this->max_child_distance = std::max(this->max_child_distance, static_cast<int>(distance));
+        this->extendLengths(child.get()->min_length, child.get()->max_length);
+    }
+}
+
+/**
+ * @brief Deserialize current node written with fixed-size fields (versions before 4)
+ *
+ * @param reader Reader of the serialized data
+ * @param version Version of the format (0 for files without a header)
+ */
+void BKTreeNode::deserializeFixed(ByteReader& reader, unsigned int version)
+{
     // Read the word
-    this->word.resize(word_len);
-    is.read(&this->word[0], word_len);
+    unsigned int word_len = reader.readValue<unsigned int>();
+    this->word.assign(reader.read(word_len), word_len);
 
-    // Read the number of child nodes
-    unsigned int num_children;
-    is.read(reinterpret_cast<char*>(&num_children), sizeof(num_children));
+    // Characters are used as indices by the edit distance calculations
+    if(!EditDistance::isValidString(this->word))
+    {
+        throw std::runtime_error("invalid BK-tree data");
+    }
+
+    this->min_length = static_cast<int>(word_len);
+    this->max_length = static_cast<int>(word_len);
+
+    // Read the range of word lengths in the subtree (older files are annotated
+    // while the children are read)
+    if(version >= 1)
+    {
+        this->min_length = static_cast<int>(reader.readValue<unsigned int>());
+        this->max_length = static_cast<int>(reader.readValue<unsigned int>());
+    }
+
+    // Read whether the word is deleted
+    this->deleted = false;
+
+    if(version >= 3)
+    {
+        unsigned char deleted = reader.readValue<unsigned char>();
+
+        if(deleted > 1)
+        {
+            throw std::runtime_error("invalid BK-tree data");
+        }
+
+        this->deleted = deleted != 0;
+    }
+
+    // Read the number of child nodes. Every child takes at least two bytes for the
+    // distance and four for the length of its word
+    unsigned int num_children = reader.readValue<unsigned int>();
+
+    if(num_children > reader.remaining() / 6)
+    {
+        throw std::runtime_error("invalid BK-tree data");
+    }
 
     // Deserialize child nodes
     for(unsigned int i = 0; i < num_children; i++)
     {
         // Read the edit distance of the child node
-        unsigned short distance;
-        is.read(reinterpret_cast<char*>(&distance), sizeof(distance));
+        unsigned short distance = reader.readValue<unsigned short>();
+
+        if(this->children.count(distance) != 0)
+        {
+            throw std::runtime_error("invalid BK-tree data");
+        }
 
         // Create and deserialize the child node
         this->children[distance] = std::make_unique<BKTreeNode>();
-        this->children[distance].get()->deserialize(is);
+        this->children[distance].get()->deserializeFixed(reader, version);
+        this->max_child_distance = std::max(this->max_child_distance, static_cast<int>(distance));
+        this->extendLengths(this->children[distance].get()->min_length,
+                            this->children[distance].get()->max_length);
     }
 }
+
+/**
+ * @brief Get a lower bound of the edit distance between a query and any word in the
+ * subtree of the current node. Every edit changes the length of a word by at most one
+ * and a wildcard stands for exactly one character, so the distance is at least the
+ * difference of the lengths
+ *
+ * @param length Length of the query
+ * @return Lower bound of the edit distance
+ */
+int BKTreeNode::lengthBound(int length) const
+{
+    return std::max({this->min_length - length, length - this->max_length, 0});
+}
+
+/**
+ * @brief Include a range of word lengths in the range of the subtree
+ *
+ * @param min_length The shortest word length
+ * @param max_length The longest word length
+ */
+void BKTreeNode::extendLengths(int min_length, int max_length)
+{
+    this->min_length = std::min(this->min_length, min_length);
+    this->max_length = std::max(this->max_length, max_length);
+}
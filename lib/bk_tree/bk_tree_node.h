@@ -20,13 +20,35 @@
 #ifndef BK_TREE_NODE_H_INCLUDED
 #define BK_TREE_NODE_H_INCLUDED
 
-#include <istream>
+#include "bk_tree_stats.h"
+#include "byte_reader.h"
+#include "edit_distance.h"
+
+#include <cstddef>
 #include <memory>
 #include <ostream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+/**
+ * @brief Version of the serialized BK-tree format. Version 0 is the original format
+ * without a header, version 1 adds the ranges of word lengths of every subtree,
+ * version 2 adds the seed and the estimated query cost of the build to the header,
+ * version 3 adds the deletion flag of every node, version 4 stores the nodes with
+ * LEB128 varints and words front-coded against the word of the parent, without the
+ * ranges of word lengths
+ *
+ */
+const unsigned int BK_TREE_FORMAT_VERSION = 4;
+
+/**
+ * @brief The longest word accepted when reading a serialized BK-tree
+ *
+ */
+const unsigned int BK_TREE_MAX_WORD_LENGTH = 1 << 16;
+
 /**
  * @brief Class that represents a node in a BK-tree
  *
@@ -45,6 +67,28 @@ private:
      *
      */
     std::unordered_map<int, std::unique_ptr<BKTreeNode>> children;
+    /**
+     * @brief The largest edit distance among the children of the current node
+     * (0 if the node has no children)
+     *
+     */
+    int max_child_distance;
+    /**
+     * @brief The shortest word length in the subtree of the current node
+     *
+     */
+    int min_length;
+    /**
+     * @brief The longest word length in the subtree of the current node
+     *
+     */
+    int max_length;
+    /**
+     * @brief Flag to denote a deleted word (tombstone). The node stays in the tree as
+     * a pivot of the search, but its word is never reported
+     *
+     */
+    bool deleted;
 
 public:
     /**
@@ -66,6 +110,19 @@ public:
      */
     void setWord(const std::string& word);
 
+    /**
+     * @brief Check if the word of the current node is deleted
+     *
+     * @return true if the word is deleted, false otherwise
+     */
+    bool isDeleted() const;
+    /**
+     * @brief Set whether the word of the current node is deleted
+     *
+     * @param deleted Whether the word is deleted
+     */
+    void setDeleted(bool deleted);
+
     /**
      * @brief Check if a node has a child node with the specified edit distance
      *
@@ -82,6 +139,33 @@ public:
      */
     BKTreeNode* getChild(int distance) const;
 
+    /**
+     * @brief Get the edit distances of all child nodes
+     *
+     * @return Edit distances of the child nodes in ascending order
+     */
+    std::vector<int> getChildDistances() const;
+
+    /**
+     * @brief Get the largest edit distance among the children of the current node
+     *
+     * @return The largest edit distance of a child node (0 if the node has no children)
+     */
+    int getMaxChildDistance() const;
+
+    /**
+     * @brief Get the shortest word length in the subtree of the current node
+     *
+     * @return The shortest word length
+     */
+    int getMinLength() const;
+    /**
+     * @brief Get the longest word length in the subtree of the current node
+     *
+     * @return The longest word length
+     */
+    int getMaxLength() const;
+
     /**
      * @brief Add a new child node
      *
@@ -91,11 +175,38 @@ public:
     void addChild(int distance, const std::string& word);
 
     /**
-     * @brief Insert a word
+     * @brief Attach an existing subtree as a child node
+     *
+     * @param distance Edit distance
+     * @param child Root of the subtree
+     */
+    void setChild(int distance, std::unique_ptr<BKTreeNode> child);
+
+    /**
+     * @brief Remove a child node with its subtree. The range of word lengths and the largest
+     * child distance are kept, they stay valid bounds for the remaining children
+     *
+     * @param distance Edit distance of the child node
+     */
+    void removeChild(int distance);
+
+    /**
+     * @brief Insert a word. A deleted node with the same word is restored instead,
+     * nothing is changed if a node with the same word is not deleted
      *
      * @param word A word to insert
+     * @param restored Set to true if a deleted node is restored, false otherwise
+     * @return true if the word is inserted or restored, false if it is already in the subtree
+     */
+    bool insert(const std::string& word, bool& restored);
+
+    /**
+     * @brief Delete a word by marking its node as a tombstone
+     *
+     * @param word A word to delete
+     * @return true if the word is deleted, false if it is not in the subtree
      */
-    void insert(const std::string& word);
+    bool remove(const std::string& word);
 
     /**
      * @brief Find all words similar to the query within the tolerance value
@@ -106,20 +217,102 @@ public:
      */
     void find(const std::string& query, unsigned int tolerance,
               std::vector<std::string>& results) const;
+    /**
+     * @brief Find all words similar to the query within the tolerance value
+     *
+     * @param query Compiled query
+     * @param tolerance Tolerance value (max edit distance)
+     * @param results A collection with results to pass
+     * @param workspace Scratch memory for edit distance calculations
+     * @param stats Statistics of the query to update (nullptr if not needed)
+     * @param depth Depth of the current node in the tree
+     */
+    void find(const EditDistance::CompiledQuery& query, unsigned int tolerance,
+              std::vector<std::string>& results, EditDistance::Workspace& workspace,
+              QueryStats* stats = nullptr, std::size_t depth = 0) const;
+
+    /**
+     * @brief Find the words closest to the query using a best-first traversal of the subtree.
+     * Subtrees are visited in the order of the lower bound of their distances, and the
+     * tolerance shrinks as soon as k words are found, so only strictly closer words are
+     * searched for after that
+     *
+     * @param query Compiled query
+     * @param k Maximum number of words to find
+     * @param max_tolerance Tolerance value (max edit distance)
+     * @param results Up to k pairs of edit distance and word, sorted by edit distance and word
+     * @param workspace Scratch memory for edit distance calculations
+     */
+    void findNearest(const EditDistance::CompiledQuery& query, std::size_t k,
+                     unsigned int max_tolerance, std::vector<std::pair<int, std::string>>& results,
+                     EditDistance::Workspace& workspace) const;
 
     /**
-     * @brief Seerialize current node
+     * @brief Count the nodes that find() visits for the query. Uses the same pruning as find()
+     *
+     * @param query Compiled query
+     * @param tolerance Tolerance value (max edit distance)
+     * @param workspace Scratch memory for edit distance calculations
+     * @return Number of nodes visited
+     */
+    std::size_t countVisits(const EditDistance::CompiledQuery& query, unsigned int tolerance,
+                            EditDistance::Workspace& workspace) const;
+
+    /**
+     * @brief Add the nodes of the subtree to the statistics of the tree shape
+     *
+     * @param stats Statistics of the tree shape
+     * @param depth Depth of the current node in the tree
+     */
+    void collectStats(TreeStats& stats, std::size_t depth = 0) const;
+
+    /**
+     * @brief Serialize current node. The word is front-coded against the word of the parent
+     * and all numbers are LEB128 varints. The ranges of word lengths are not written,
+     * they are computed again while the children are read
      *
      * @param os Output stream
+     * @param parent_word Word of the parent node (empty for the root)
      */
-    void serialize(std::ostream& os) const;
+    void serialize(std::ostream& os, const std::string& parent_word = std::string()) const;
 
     /**
      * @brief Deserialize current node
      *
-     * @param is Input stream
+     * @param reader Reader of the serialized data
+     * @param version Version of the format (0 for files without a header)
+     * @param parent_word Word of the parent node (empty for the root)
+     */
+    void deserialize(ByteReader& reader, unsigned int version = 0,
+                     const std::string& parent_word = std::string());
+
+private:
+    /**
+     * @brief Deserialize current node written with fixed-size fields (versions before 4)
+     *
+     * @param reader Reader of the serialized data
+     * @param version Version of the format (0 for files without a header)
+     */
+    void deserializeFixed(ByteReader& reader, unsigned int version);
+
+    /**
+     * @brief Get a lower bound of the edit distance between a query and any word in the
+     * subtree of the current node. Every edit changes the length of a word by at most one
+     * and a wildcard stands for exactly one character, so the distance is at least the
+     * difference of the lengths
+     *
+     * @param length Length of the query
+     * @return Lower bound of the edit distance
+     */
+    int lengthBound(int length) const;
+
+    /**
+     * @brief Include a range of word lengths in the range of the subtree
+     *
+     * @param min_length The shortest word length
+     * @param max_length The longest word length
      */
-    void deserialize(std::istream& is);
+    void extendLengths(int min_length, int max_length);
 };
 
 #endif // BK_TREE_NODE_H_INCLUDED
@@ -0,0 +1,116 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BK_TREE_STATS_H_INCLUDED
+#define BK_TREE_STATS_H_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Run a statement that updates query statistics. Statistics are only collected if
+ * the library is built with BK_TREE_QUERY_STATS defined, otherwise the statement is removed
+ * at compile time
+ *
+ */
+#ifdef BK_TREE_QUERY_STATS
+#define BK_TREE_COUNT(stats, statement) \
+    do                                  \
+    {                                   \
+        if((stats) != nullptr)          \
+        {                               \
+            statement;                  \
+        }                               \
+    } while(false)
+#else
+#define BK_TREE_COUNT(stats, statement) \
+    do                                  \
+    {                                   \
+    } while(false)
+#endif
+
+/**
+ * @brief Statistics of a single BK-tree query. The counters are only updated if the
+ * library is built with BK_TREE_QUERY_STATS defined, the wall time is always measured
+ *
+ */
+struct QueryStats
+{
+    /**
+     * @brief Number of nodes visited
+     *
+     */
+    std::size_t nodes_visited = 0;
+    /**
+     * @brief Number of edit distance calculations
+     *
+     */
+    std::size_t distance_calls = 0;
+    /**
+     * @brief Number of subtrees skipped by the triangle inequality
+     *
+     */
+    std::size_t pruned_subtrees = 0;
+    /**
+     * @brief Number of subtrees skipped by the range of word lengths
+     *
+     */
+    std::size_t length_pruned_subtrees = 0;
+    /**
+     * @brief Maximum depth reached (the root is at depth 0)
+     *
+     */
+    std::size_t max_depth = 0;
+    /**
+     * @brief Wall time of the query
+     *
+     */
+    std::chrono::nanoseconds wall_time = std::chrono::nanoseconds::zero();
+};
+
+/**
+ * @brief Statistics of the shape of a BK-tree
+ *
+ */
+struct TreeStats
+{
+    /**
+     * @brief Number of nodes
+     *
+     */
+    std::size_t node_count = 0;
+    /**
+     * @brief Number of nodes with a deleted word (tombstones)
+     *
+     */
+    std::size_t dead_count = 0;
+    /**
+     * @brief Number of nodes at every depth (the root is at depth 0)
+     *
+     */
+    std::vector<std::size_t> depth_histogram;
+    /**
+     * @brief Number of nodes with every number of children
+     *
+     */
+    std::vector<std::size_t> fanout_histogram;
+};
+
+#endif // BK_TREE_STATS_H_INCLUDED
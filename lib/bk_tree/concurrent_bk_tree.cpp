@@ -0,0 +1,201 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "concurrent_bk_tree.h"
+#include "bk_tree.h"
+
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Constructor
+ *
+ * @param tree The tree (moved)
+ * @param threshold Fraction of deleted nodes that starts a rebuild
+ * @param threads Number of threads of a rebuild (0 means one per hardware thread)
+ */
+ConcurrentBKTree::ConcurrentBKTree(BKTree tree, double threshold, unsigned int threads) :
+    tree(std::move(tree)),
+    threshold(threshold),
+    threads(threads),
+    generation(0),
+    mutex(),
+    worker_mutex(),
+    worker(),
+    rebuilding(false)
+{
+}
+
+/**
+ * @brief Destructor. Waits for a running rebuild
+ *
+ */
+ConcurrentBKTree::~ConcurrentBKTree()
+{
+    this->wait();
+}
+
+/**
+ * @brief Find all words similar to the query within the tolerance value
+ *
+ * @param query Query
+ * @param tolerance Tolerance value (max edit distance)
+ * @return A list of matching words
+ */
+std::vector<std::string> ConcurrentBKTree::find(const std::string& query,
+                                                unsigned int tolerance) const
+{
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+
+    if(this->tree.getRoot() == nullptr)
+    {
+        return std::vector<std::string>();
+    }
+
+    return this->tree.find(query, tolerance);
+}
+
+/**
+ * @brief Insert a word into the tree
+ *
+ * @param word A word to insert
+ */
+void ConcurrentBKTree::insert(const std::string& word)
+{
+    std::unique_lock<std::shared_mutex> lock(this->mutex);
+    this->tree.insert(word);
+    this->generation++;
+}
+
+/**
+ * @brief Delete a word. Starts a background rebuild if the fraction of deleted
+ * nodes exceeds the threshold
+ *
+ * @param word A word to delete
+ * @return true if the word is deleted, false if it is not in the tree
+ */
+bool ConcurrentBKTree::remove(const std::string& word)
+{
+    bool start;
+
+    {
+        std::unique_lock<std::shared_mutex> lock(this->mutex);
+
+        if(!this->tree.remove(word))
+        {
+            return false;
+        }
+
+        this->generation++;
+        start = this->tree.getDeadFraction() > this->threshold;
+    }
+
+    // Only one rebuild runs at a time
+    if(start && !this->rebuilding.exchange(true))
+    {
+        std::lock_guard<std::mutex> lock(this->worker_mutex);
+
+        if(this->worker.joinable())
+        {
+            this->worker.join();
+        }
+
+        this->worker = std::thread(&ConcurrentBKTree::rebuild, this);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Get the fraction of nodes with a deleted word
+ *
+ * @return Fraction of deleted nodes
+ */
+double ConcurrentBKTree::getDeadFraction() const
+{
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+    return this->tree.getDeadFraction();
+}
+
+/**
+ * @brief Wait for a running rebuild to finish
+ *
+ */
+void ConcurrentBKTree::wait()
+{
+    std::lock_guard<std::mutex> lock(this->worker_mutex);
+
+    if(this->worker.joinable())
+    {
+        this->worker.join();
+    }
+}
+
+/**
+ * @brief Rebuild the subtrees with the most deleted nodes and attach them.
+ * The rebuild is repeated if the tree is modified in the meantime
+ *
+ */
+void ConcurrentBKTree::rebuild()
+{
+    try
+    {
+        // A rebuild that is overtaken by a modification is retried, as long as the tree
+        // still has too many deleted nodes
+        while(true)
+        {
+            std::vector<BKTree::SubtreeRebuild> rebuilds;
+            std::uint64_t generation;
+
+            // The new subtrees are built next to the old ones, so queries are not blocked
+            {
+                std::shared_lock<std::shared_mutex> lock(this->mutex);
+
+                if(this->tree.getDeadFraction() <= this->threshold)
+                {
+                    break;
+                }
+
+                generation = this->generation;
+                rebuilds = this->tree.rebuildSubtrees(this->threshold, this->threads);
+            }
+
+            std::unique_lock<std::shared_mutex> lock(this->mutex);
+
+            if(generation == this->generation)
+            {
+                this->tree.replaceSubtrees(rebuilds);
+                this->generation++;
+                break;
+            }
+        }
+    }
+    catch(const std::exception&)
+    {
+        // The tree stays valid with its tombstones, the next deletion retries
+    }
+
+    this->rebuilding = false;
+}
@@ -0,0 +1,151 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CONCURRENT_BK_TREE_H_INCLUDED
+#define CONCURRENT_BK_TREE_H_INCLUDED
+
+#include "bk_tree.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Class that represents a BK-tree shared by the threads of a running service.
+ * Queries run concurrently, insertions and deletions are exclusive. Deleted words stay
+ * in the tree as tombstones until their fraction passes a threshold, then the subtrees
+ * with the most tombstones are rebuilt on a background thread while queries go on.
+ * A rebuild is repeated if the tree is modified before it is attached
+ *
+ */
+class ConcurrentBKTree
+{
+private:
+    /**
+     * @brief The tree
+     *
+     */
+    BKTree tree;
+    /**
+     * @brief Fraction of deleted nodes that starts a rebuild
+     *
+     */
+    double threshold;
+    /**
+     * @brief Number of threads of a rebuild (0 means one per hardware thread)
+     *
+     */
+    unsigned int threads;
+    /**
+     * @brief Number of modifications of the tree, used to detect stale rebuilds
+     *
+     */
+    std::uint64_t generation;
+    /**
+     * @brief Lock of the tree and the generation
+     *
+     */
+    mutable std::shared_mutex mutex;
+    /**
+     * @brief Lock of the background thread
+     *
+     */
+    std::mutex worker_mutex;
+    /**
+     * @brief Background thread of the last rebuild
+     *
+     */
+    std::thread worker;
+    /**
+     * @brief Flag to denote a running rebuild
+     *
+     */
+    std::atomic<bool> rebuilding;
+
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param tree The tree (moved)
+     * @param threshold Fraction of deleted nodes that starts a rebuild
+     * @param threads Number of threads of a rebuild (0 means one per hardware thread)
+     */
+    explicit ConcurrentBKTree(BKTree tree, double threshold = 0.1, unsigned int threads = 1);
+
+    /**
+     * @brief Destructor. Waits for a running rebuild
+     *
+     */
+    ~ConcurrentBKTree();
+
+    ConcurrentBKTree(const ConcurrentBKTree&) = delete;
+    ConcurrentBKTree& operator=(const ConcurrentBKTree&) = delete;
+
+    /**
+     * @brief Find all words similar to the query within the tolerance value
+     *
+     * @param query Query
+     * @param tolerance Tolerance value (max edit distance)
+     * @return A list of matching words
+     */
+    std::vector<std::string> find(const std::string& query, unsigned int tolerance = 2) const;
+
+    /**
+     * @brief Insert a word into the tree
+     *
+     * @param word A word to insert
+     */
+    void insert(const std::string& word);
+
+    /**
+     * @brief Delete a word. Starts a background rebuild if the fraction of deleted
+     * nodes exceeds the threshold
+     *
+     * @param word A word to delete
+     * @return true if the word is deleted, false if it is not in the tree
+     */
+    bool remove(const std::string& word);
+
+    /**
+     * @brief Get the fraction of nodes with a deleted word
+     *
+     * @return Fraction of deleted nodes
+     */
+    double getDeadFraction() const;
+
+    /**
+     * @brief Wait for a running rebuild to finish
+     *
+     */
+    void wait();
+
+private:
+    /**
+     * @brief Rebuild the subtrees with the most deleted nodes and attach them.
+     * The rebuild is repeated if the tree is modified in the meantime
+     *
+     */
+    void rebuild();
+};
+
+#endif // CONCURRENT_BK_TREE_H_INCLUDED
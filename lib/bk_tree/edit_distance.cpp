@@ -20,6 +20,12 @@
 #include "edit_distance.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 /**
@@ -44,6 +50,62 @@ int EditDistance::charToIndex(char c)
     return -1;
 }
 
+/**
+ * @brief Check if every character of a string is supported by the edit distance
+ * calculations (lowercase letters and wildcards)
+ *
+ * @param s A string
+ * @return true if all characters are supported, false otherwise
+ */
+bool EditDistance::isValidString(std::string_view s)
+{
+    for(char c : s)
+    {
+        if(charToIndex(c) < 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Default constructor
+ *
+ */
+EditDistance::Workspace::Workspace() : cells() {}
+
+/**
+ * @brief Get storage for an edit distance matrix. The storage is reused
+ * between calls and only grows, so it is allocated once for the longest strings
+ *
+ * @param rows Number of rows in the matrix
+ * @param columns Number of columns in the matrix
+ * @return Pointer to the storage of rows * columns cells (row-major order)
+ */
+int* EditDistance::Workspace::matrix(std::size_t rows, std::size_t columns)
+{
+    if(this->cells.size() < rows * columns)
+    {
+        this->cells.resize(rows * columns);
+    }
+
+    return this->cells.data();
+}
+
+/**
+ * @brief Get the workspace of the calling thread. It is used by the overloads
+ * that do not take a workspace
+ *
+ * @return Workspace of the calling thread
+ */
+EditDistance::Workspace& EditDistance::threadWorkspace()
+{
+    thread_local Workspace workspace;
+    return workspace;
+}
+
 /**
  * @brief Calculate edit distance between two strings using Damerau–Levenshtein distance
  * <https://en.wikipedia.org/wiki/Damerau–Levenshtein_distance>
@@ -54,38 +116,97 @@ int EditDistance::charToIndex(char c)
  */
 int EditDistance::editDistance(const std::string& a, const std::string& b)
 {
-    size_t len_a = a.length();
-    size_t len_b = b.length();
-    size_t maxdist = len_a + len_b;
+    return editDistance(a, b, threadWorkspace());
+}
 
-    // da[i] is the last row in the edit matrix d where character i appeared in string a
-    std::vector<int> da(ALPHABET_SIZE, 0);
+/**
+ * @brief Calculate edit distance between two strings using Damerau–Levenshtein distance
+ * <https://en.wikipedia.org/wiki/Damerau–Levenshtein_distance>
+ *
+ * @param a First string
+ * @param b Second string
+ * @param workspace Scratch memory for the edit distance matrix
+ * @return Edit distance
+ */
+int EditDistance::editDistance(const std::string& a, const std::string& b, Workspace& workspace)
+{
+    int distance;
+
+    // The distance never exceeds the length of the longer string
+    if(editDistanceBitParallel(a, b, static_cast<int>(std::max(a.length(), b.length())),
+                               distance))
+    {
+        return distance;
+    }
+
+    return editDistanceMatrix(a, b, workspace);
+}
+
+/**
+ * @brief Calculate edit distance between two strings, but stop as soon as it is known
+ * to exceed the cap. Uses a banded (Ukkonen) matrix if the bit-parallel kernel is not
+ * applicable
+ *
+ * @param a First string
+ * @param b Second string
+ * @param cap Maximum edit distance of interest
+ * @return Edit distance if it does not exceed the cap, otherwise cap + 1
+ */
+int EditDistance::editDistanceBounded(const std::string& a, const std::string& b, int cap)
+{
+    return editDistanceBounded(a, b, cap, threadWorkspace());
+}
+
+/**
+ * @brief Calculate edit distance between two strings using a banded (Ukkonen) matrix.
+ * Only the cells within the cap of the main diagonal are calculated
+ *
+ * @param a First string
+ * @param b Second string
+ * @param cap Maximum edit distance of interest
+ * @param workspace Scratch memory for the edit distance matrix
+ * @return Edit distance if it does not exceed the cap, otherwise cap + 1
+ */
+static int editDistanceBanded(const std::string& a, std::string_view b, int cap,
+                              EditDistance::Workspace& workspace)
+{
+    int len_a = static_cast<int>(a.length());
+    int len_b = static_cast<int>(b.length());
 
-    // Edit distance matrix. d[i][j] is the distance between the first i characters
-    // of string a and the first j characters of string b
-    std::vector<std::vector<int>> d(len_a + 2, std::vector<int>(len_b + 2));
+    // Any value above the cap is stored as cap + 1
+    const int infinity = cap + 1;
 
-    d[0][0] = maxdist;
+    // da[i] is the last row in the edit matrix d where character i appeared in string a
+    int da[EditDistance::ALPHABET_SIZE] = {};
 
-    for(int i = 1; i <= len_a + 1; i++)
+    // Edit distance matrix with the same layout as in editDistanceMatrix. Only the cells
+    // within the band |i - j| <= cap are calculated, all other cells exceed the cap
+    const int columns = len_b + 2;
+    int* d = workspace.matrix(len_a + 2, columns);
+    std::fill(d, d + (len_a + 2) * columns, infinity);
+
+    for(int i = 1; i <= len_a + 1 && i - 1 <= cap; i++)
     {
-        d[i][0] = maxdist;
-        d[i][1] = i - 1;
+        d[i * columns + 1] = i - 1;
     }
 
-    for(int j = 1; j <= len_b + 1; j++)
+    for(int j = 1; j <= len_b + 1 && j - 1 <= cap; j++)
     {
-        d[0][j] = maxdist;
-        d[1][j] = j - 1;
+        d[columns + j] = j - 1;
     }
 
     for(int i = 1; i <= len_a; i++)
     {
+        // Matches to the left of the band can only lead to transpositions that exceed the cap
         int db = 0;
+        int row_min = d[(i + 1) * columns + 1];
+
+        int from = std::max(1, i - cap);
+        int to = std::min(len_b, i + cap);
 
-        for(int j = 1; j <= len_b; j++)
+        for(int j = from; j <= to; j++)
         {
-            int k = da[charToIndex(b[j - 1])];
+            int k = da[EditDistance::charToIndex(b[j - 1])];
             int l = db;
 
             int cost;
@@ -99,16 +220,579 @@ int EditDistance::editDistance(const std::string& a, const std::string& b)
                 cost = 1;
             }
 
-            d[i + 1][j + 1] = std::min({
-                d[i][j] + cost, // substitution
-                d[i + 1][j] + 1, // insertion
-                d[i][j + 1] + 1, // deletion
-                d[k][l] + (i - k - 1) + 1 + (j - l - 1) // transposition
+            // Cells of the first row and column are at the distance of maxdist
+            int transposition = (k == 0 || l == 0)
+                                    ? infinity
+                                    : d[k * columns + l] + (i - k - 1) + 1 + (j - l - 1);
+
+            int value = std::min({
+                d[i * columns + j] + cost, // substitution
+                d[(i + 1) * columns + j] + 1, // insertion
+                d[i * columns + j + 1] + 1, // deletion
+                transposition, // transposition
+                infinity
+            });
+
+            d[(i + 1) * columns + j + 1] = value;
+            row_min = std::min(row_min, value);
+        }
+
+        // Every path to the last cell passes this row, so the distance exceeds the cap
+        if(row_min > cap)
+        {
+            return infinity;
+        }
+
+        da[EditDistance::charToIndex(a[i - 1])] = i;
+    }
+
+    return d[(len_a + 1) * columns + len_b + 1];
+}
+
+/**
+ * @brief Calculate edit distance between two strings, but stop as soon as it is known
+ * to exceed the cap. Uses a banded (Ukkonen) matrix if the bit-parallel kernel is not
+ * applicable
+ *
+ * @param a First string
+ * @param b Second string
+ * @param cap Maximum edit distance of interest
+ * @param workspace Scratch memory for the edit distance matrix
+ * @return Edit distance if it does not exceed the cap, otherwise cap + 1
+ */
+int EditDistance::editDistanceBounded(const std::string& a, const std::string& b, int cap,
+                                      Workspace& workspace)
+{
+    // The distance is at least the difference of the lengths
+    if(std::abs(static_cast<int>(a.length()) - static_cast<int>(b.length())) > cap)
+    {
+        return cap + 1;
+    }
+
+    int distance;
+
+    if(editDistanceBitParallel(a, b, cap, distance))
+    {
+        return distance;
+    }
+
+    return editDistanceBanded(a, b, cap, workspace);
+}
+
+/**
+ * @brief Calculate edit distance between two strings by filling the full
+ * Damerau–Levenshtein edit distance matrix
+ *
+ * @param a First string
+ * @param b Second string
+ * @return Edit distance
+ */
+int EditDistance::editDistanceMatrix(const std::string& a, const std::string& b)
+{
+    return editDistanceMatrix(a, b, threadWorkspace());
+}
+
+/**
+ * @brief Calculate edit distance between two strings by filling the full
+ * Damerau–Levenshtein edit distance matrix
+ *
+ * @param a First string
+ * @param b Second string
+ * @param workspace Scratch memory for the edit distance matrix
+ * @return Edit distance
+ */
+int EditDistance::editDistanceMatrix(const std::string& a, const std::string& b,
+                                     Workspace& workspace)
+{
+    size_t len_a = a.length();
+    size_t len_b = b.length();
+    int maxdist = static_cast<int>(len_a + len_b);
+
+    // da[i] is the last row in the edit matrix d where character i appeared in string a
+    int da[ALPHABET_SIZE] = {};
+
+    // Edit distance matrix stored row by row. d[i][j] is the distance between the first i
+    // characters of string a and the first j characters of string b
+    const size_t columns = len_b + 2;
+    int* d = workspace.matrix(len_a + 2, columns);
+
+    d[0] = maxdist;
+
+    for(size_t i = 1; i <= len_a + 1; i++)
+    {
+        d[i * columns] = maxdist;
+        d[i * columns + 1] = static_cast<int>(i - 1);
+    }
+
+    for(size_t j = 1; j <= len_b + 1; j++)
+    {
+        d[j] = maxdist;
+        d[columns + j] = static_cast<int>(j - 1);
+    }
+
+    for(size_t i = 1; i <= len_a; i++)
+    {
+        size_t db = 0;
+
+        for(size_t j = 1; j <= len_b; j++)
+        {
+            size_t k = da[charToIndex(b[j - 1])];
+            size_t l = db;
+
+            int cost;
+            if((a[i - 1] == b[j - 1]) || (a[i - 1] == '*') || (b[j - 1] == '*'))
+            {
+                cost = 0;
+                db = j;
+            }
+            else
+            {
+                cost = 1;
+            }
+
+            int transposition = d[k * columns + l] +
+                                static_cast<int>((i - k - 1) + 1 + (j - l - 1));
+
+            d[(i + 1) * columns + j + 1] = std::min({
+                d[i * columns + j] + cost, // substitution
+                d[(i + 1) * columns + j] + 1, // insertion
+                d[i * columns + j + 1] + 1, // deletion
+                transposition // transposition
             });
         }
 
-        da[charToIndex(a[i - 1])] = i;
+        da[charToIndex(a[i - 1])] = static_cast<int>(i);
+    }
+
+    return d[(len_a + 1) * columns + len_b + 1];
+}
+
+/**
+ * @brief Build the match masks of a string for the bit-parallel kernel
+ *
+ * @param a A string (between 1 and BIT_PARALLEL_MAX_LENGTH characters)
+ * @param masks Match masks
+ * @return true if all characters of the string are valid, false otherwise
+ */
+static bool buildMatchMasks(const std::string& a, EditDistance::MatchMasks& masks)
+{
+    const unsigned int wildcard = EditDistance::ALPHABET_SIZE - 1;
+
+    std::fill(std::begin(masks.peq_exact), std::end(masks.peq_exact), 0);
+
+    for(std::size_t i = 0; i < a.length(); i++)
+    {
+        int index = EditDistance::charToIndex(a[i]);
+
+        if(index < 0)
+        {
+            return false;
+        }
+
+        masks.peq_exact[index] |= std::uint64_t(1) << i;
+    }
+
+    // A wildcard in a matches any character, a wildcard in b matches any position
+    for(unsigned int c = 0; c < EditDistance::ALPHABET_SIZE; c++)
+    {
+        masks.peq[c] = masks.peq_exact[c] | masks.peq_exact[wildcard];
+
+        std::uint64_t exact = masks.peq_exact[c];
+        int first = (exact != 0) ? __builtin_ctzll(exact) : 64;
+        masks.peq_before[c] = (first + 2 >= 64) ? 0 : ~((std::uint64_t(1) << (first + 2)) - 1);
+    }
+    masks.peq[wildcard] = ~std::uint64_t(0);
+
+    masks.rows = (a.length() >= 64) ? ~std::uint64_t(0) : (std::uint64_t(1) << a.length()) - 1;
+
+    return true;
+}
+
+/**
+ * @brief Get the value of the cell of the edit distance matrix from the vertical deltas of
+ * the columns computed by the bit-parallel kernel. Column c stores the differences
+ * d[r][c] - d[r - 1][c], where d[-1][c] = c + 1
+ *
+ * @param vp_cols Positive vertical deltas of the columns
+ * @param vn_cols Negative vertical deltas of the columns
+ * @param stride Distance between two consecutive columns in the arrays
+ * @param r Row (the edit distance is calculated for the first r + 1 characters of a)
+ * @param c Column (the edit distance is calculated for the first c + 1 characters of b)
+ * @return Edit distance between a[0..r] and b[0..c]
+ */
+static int columnValue(const std::uint64_t* vp_cols, const std::uint64_t* vn_cols,
+                       std::size_t stride, int r, int c)
+{
+    if(r < 0)
+    {
+        return c + 1;
+    }
+
+    if(c < 0)
+    {
+        return r + 1;
+    }
+
+    std::uint64_t mask = (r >= 63) ? ~std::uint64_t(0) : (std::uint64_t(2) << r) - 1;
+
+    return c + 1 + __builtin_popcountll(vp_cols[c * stride] & mask) -
+           __builtin_popcountll(vn_cols[c * stride] & mask);
+}
+
+/**
+ * @brief Get the rows that may take a transposition with exactly one of the gaps between the
+ * transposed characters being non-empty. Either a[i - 1] = b[j] and a[i] last matched b
+ * before b[j - 1], or a[i] matches b[j - 1] and b[j] last appeared in a before a[i - 1].
+ * Transpositions with both gaps non-empty are never cheaper than substitutions, insertions
+ * and deletions, transpositions without gaps are handled by the kernel itself.
+ * Such a transposition can only save one operation over the path through d[i - 1][j]
+ * (or d[i][j - 1]), so the vertical (or horizontal) delta in the row must be positive
+ *
+ * @param exact Rows where a[i] is exactly b[j]
+ * @param before Rows where b[j] appears exactly in a[0..i - 2]
+ * @param pm_prev Rows where a[i] matches b[j - 1]
+ * @param matched Rows that matched any column before b[j - 1]
+ * @param vp Positive vertical deltas of column j
+ * @param hp Positive horizontal deltas between columns j - 1 and j
+ * @param rows Mask of valid rows
+ * @return Rows that need to be corrected
+ */
+static std::uint64_t gappedTranspositions(std::uint64_t exact, std::uint64_t before,
+                                          std::uint64_t pm_prev, std::uint64_t matched,
+                                          std::uint64_t vp, std::uint64_t hp, std::uint64_t rows)
+{
+    return (((exact << 1) & ~pm_prev & matched & vp) | (pm_prev & ~(exact << 1) & before & hp)) &
+           rows;
+}
+
+/**
+ * @brief Apply transpositions with one non-empty gap to column j computed by the
+ * bit-parallel kernel. The column must already be stored in the arrays of vertical deltas
+ *
+ * @param a First string
+ * @param j Index of the column
+ * @param exact Rows where a[i] is exactly b[j]
+ * @param pm_prev Rows where a[i] matches b[j - 1]
+ * @param gapped Rows returned by gappedTranspositions
+ * @param b Second string
+ * @param vp_cols Positive vertical deltas of the columns
+ * @param vn_cols Negative vertical deltas of the columns
+ * @param stride Distance between two consecutive columns in the arrays
+ * @param vp Positive vertical deltas of column j
+ * @param vn Negative vertical deltas of column j
+ * @param d0 Diagonal zero deltas of column j
+ */
+static void correctColumn(const std::string& a, int j, std::uint64_t exact, std::uint64_t pm_prev,
+                          std::uint64_t gapped, std::string_view b, std::uint64_t* vp_cols,
+                          std::uint64_t* vn_cols, std::size_t stride, std::uint64_t& vp,
+                          std::uint64_t& vn, std::uint64_t& d0)
+{
+    const int len_a = static_cast<int>(a.length());
+
+    int candidates[EditDistance::BIT_PARALLEL_MAX_LENGTH];
+    std::uint64_t improved = 0;
+
+    for(std::uint64_t bits = gapped; bits != 0; bits &= bits - 1)
+    {
+        int i = __builtin_ctzll(bits);
+        int k, l;
+
+        if((pm_prev >> i) & 1)
+        {
+            // Gap in a: b[j] last appeared in a at row k
+            l = j - 1;
+            k = 63 - __builtin_clzll(exact & ((std::uint64_t(1) << i) - 1));
+        }
+        else
+        {
+            // Gap in b: a[i] last matched b at column l (a[i] is not a wildcard,
+            // otherwise it would match b[j - 1])
+            k = i - 1;
+            l = j - 2;
+
+            while(b[l] != a[i] && b[l] != '*')
+            {
+                l--;
+            }
+        }
+
+        int cost = columnValue(vp_cols, vn_cols, stride, k - 1, l - 1) + (i - k - 1) + 1 +
+                   (j - l - 1);
+
+        if(cost < columnValue(vp_cols, vn_cols, stride, i, j))
+        {
+            candidates[i] = cost;
+            improved |= std::uint64_t(1) << i;
+        }
+    }
+
+    if(improved == 0)
+    {
+        return;
+    }
+
+    // Rebuild the column from its absolute values with the corrected cells
+    int above = j + 1;
+    int diagonal = j;
+    std::uint64_t new_vp = 0;
+    std::uint64_t new_vn = 0;
+    std::uint64_t new_d0 = 0;
+
+    for(int i = 0; i < len_a; i++)
+    {
+        int current = columnValue(vp_cols, vn_cols, stride, i, j);
+
+        if((improved >> i) & 1)
+        {
+            current = std::min(current, candidates[i]);
+        }
+
+        current = std::min(current, above + 1);
+
+        if(current > above)
+        {
+            new_vp |= std::uint64_t(1) << i;
+        }
+        else if(current < above)
+        {
+            new_vn |= std::uint64_t(1) << i;
+        }
+
+        if(current == diagonal)
+        {
+            new_d0 |= std::uint64_t(1) << i;
+        }
+
+        diagonal = columnValue(vp_cols, vn_cols, stride, i, j - 1);
+        above = current;
+    }
+
+    vp = new_vp;
+    vn = new_vn;
+    d0 = new_d0;
+    vp_cols[j * stride] = vp;
+    vn_cols[j * stride] = vn;
+}
+
+/**
+ * @brief Calculate edit distance between two strings using the bit-parallel kernel
+ * with prebuilt match masks of the first string
+ *
+ * @param a First string (between 1 and BIT_PARALLEL_MAX_LENGTH valid characters)
+ * @param masks Match masks of the first string
+ * @param b Second string
+ * @param cap Maximum edit distance of interest
+ * @param distance Edit distance if it does not exceed the cap, otherwise cap + 1
+ * (only set if the kernel was applicable)
+ * @return true if the kernel was applicable and the distance was calculated,
+ * false otherwise
+ */
+static bool bitParallelDistance(const std::string& a, const EditDistance::MatchMasks& masks,
+                                std::string_view b, int cap, int& distance)
+{
+    const int len_a = static_cast<int>(a.length());
+    const int len_b = static_cast<int>(b.length());
+
+    if(len_b > static_cast<int>(EditDistance::BIT_PARALLEL_MAX_LENGTH))
+    {
+        return false;
+    }
+
+    // Vertical positive and negative deltas of every processed column
+    std::uint64_t vp_cols[EditDistance::BIT_PARALLEL_MAX_LENGTH];
+    std::uint64_t vn_cols[EditDistance::BIT_PARALLEL_MAX_LENGTH];
+
+    // Rows that matched any column before the previous one
+    std::uint64_t matched = 0;
+
+    std::uint64_t vp = ~std::uint64_t(0);
+    std::uint64_t vn = 0;
+    std::uint64_t d0 = 0;
+    std::uint64_t pm_prev = 0;
+
+    for(int j = 0; j < len_b; j++)
+    {
+        int index = EditDistance::charToIndex(b[j]);
+
+        if(index < 0)
+        {
+            return false;
+        }
+
+        std::uint64_t pm = masks.peq[index];
+        std::uint64_t exact = masks.peq_exact[index];
+
+        // Transposition of adjacent characters a[i - 1] a[i] and b[j - 1] b[j]
+        std::uint64_t tr = (((~d0) & exact) << 1) & pm_prev;
+
+        d0 = (((pm & vp) + vp) ^ vp) | pm | vn | tr;
+
+        std::uint64_t hp = vn | ~(d0 | vp);
+        std::uint64_t hn = vp & d0;
+        std::uint64_t hp_row = hp;
+
+        hp = (hp << 1) | 1;
+        hn = hn << 1;
+
+        vp = hn | ~(d0 | hp);
+        vn = hp & d0;
+
+        vp_cols[j] = vp;
+        vn_cols[j] = vn;
+
+        std::uint64_t gapped = gappedTranspositions(exact, masks.peq_before[index], pm_prev,
+                                                    matched, vp, hp_row, masks.rows);
+
+        if(gapped != 0)
+        {
+            correctColumn(a, j, exact, pm_prev, gapped, b, vp_cols, vn_cols, 1, vp, vn, d0);
+        }
+
+        // Values never decrease along a diagonal, so the distance is at least
+        // the value on the diagonal that leads to the last cell
+        int diagonal_row = len_a - len_b + j;
+
+        if(diagonal_row >= 0 && columnValue(vp_cols, vn_cols, 1, diagonal_row, j) > cap)
+        {
+            distance = cap + 1;
+            return true;
+        }
+
+        matched |= pm_prev;
+        pm_prev = pm;
+    }
+
+    distance = std::min(columnValue(vp_cols, vn_cols, 1, len_a - 1, len_b - 1), cap + 1);
+    return true;
+}
+
+/**
+ * @brief Calculate edit distance between two strings using a bit-parallel kernel
+ * (Myers' algorithm with Hyyrö's transposition extension). Transpositions with characters
+ * inserted or deleted between the transposed ones are applied as a correction of the
+ * affected columns, so the result is equal to the one computed by editDistanceMatrix
+ *
+ * @param a First string (at most BIT_PARALLEL_MAX_LENGTH characters)
+ * @param b Second string (at most BIT_PARALLEL_MAX_LENGTH characters)
+ * @param cap Maximum edit distance of interest
+ * @param distance Edit distance if it does not exceed the cap, otherwise cap + 1
+ * (only set if the kernel was applicable)
+ * @return true if the kernel was applicable and the distance was calculated,
+ * false otherwise
+ */
+bool EditDistance::editDistanceBitParallel(const std::string& a, const std::string& b, int cap,
+                                           int& distance)
+{
+    const int len_a = static_cast<int>(a.length());
+    const int len_b = static_cast<int>(b.length());
+
+    if(len_a > static_cast<int>(BIT_PARALLEL_MAX_LENGTH) ||
+       len_b > static_cast<int>(BIT_PARALLEL_MAX_LENGTH))
+    {
+        return false;
+    }
+
+    if(len_a == 0)
+    {
+        distance = std::min(len_b, cap + 1);
+        return true;
+    }
+
+    MatchMasks masks;
+
+    if(!buildMatchMasks(a, masks))
+    {
+        return false;
+    }
+
+    return bitParallelDistance(a, masks, b, cap, distance);
+}
+
+/**
+ * @brief Constructor
+ *
+ * @param text Text of the query
+ */
+EditDistance::CompiledQuery::CompiledQuery(const std::string& text)
+    : text(text), masks(), bit_parallel(false)
+{
+    this->bit_parallel = !text.empty() && text.length() <= BIT_PARALLEL_MAX_LENGTH &&
+                         buildMatchMasks(text, this->masks);
+}
+
+/**
+ * @brief Get the text of the query
+ *
+ * @return Text of the query
+ */
+const std::string& EditDistance::CompiledQuery::getText() const
+{
+    return this->text;
+}
+
+/**
+ * @brief Get the match masks of the query
+ *
+ * @return Match masks of the query (only valid if isBitParallel() is true)
+ */
+const EditDistance::MatchMasks& EditDistance::CompiledQuery::getMasks() const
+{
+    return this->masks;
+}
+
+/**
+ * @brief Check if the query can be processed by the bit-parallel kernel
+ *
+ * @return true if the bit-parallel kernel is applicable, otherwise false
+ */
+bool EditDistance::CompiledQuery::isBitParallel() const
+{
+    return this->bit_parallel;
+}
+
+/**
+ * @brief Check if the query contains wildcards
+ *
+ * @return true if the query contains at least one wildcard, otherwise false
+ */
+bool EditDistance::CompiledQuery::hasWildcards() const
+{
+    if(this->bit_parallel)
+    {
+        return this->masks.peq_exact[ALPHABET_SIZE - 1] != 0;
+    }
+
+    return this->text.find('*') != std::string::npos;
+}
+
+/**
+ * @brief Calculate edit distance between a compiled query and a string, but stop as soon
+ * as it is known to exceed the cap. Uses a banded (Ukkonen) matrix if the bit-parallel
+ * kernel is not applicable
+ *
+ * @param a Compiled query
+ * @param b Second string
+ * @param cap Maximum edit distance of interest
+ * @param workspace Scratch memory for the edit distance matrix
+ * @return Edit distance if it does not exceed the cap, otherwise cap + 1
+ */
+int EditDistance::editDistanceBounded(const CompiledQuery& a, std::string_view b, int cap,
+                                      Workspace& workspace)
+{
+    const std::string& text = a.getText();
+
+    // The distance is at least the difference of the lengths
+    if(std::abs(static_cast<int>(text.length()) - static_cast<int>(b.length())) > cap)
+    {
+        return cap + 1;
+    }
+
+    int distance;
+
+    if(a.isBitParallel() && bitParallelDistance(text, a.getMasks(), b, cap, distance))
+    {
+        return distance;
     }
 
-    return d[len_a + 1][len_b + 1];
+    return editDistanceBanded(text, b, cap, workspace);
 }
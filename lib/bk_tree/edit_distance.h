@@ -20,7 +20,11 @@
 #ifndef EDIT_DISTANCE_H_INCLUDED
 #define EDIT_DISTANCE_H_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace EditDistance
 {
@@ -30,6 +34,145 @@ namespace EditDistance
      *
      */
     const unsigned int ALPHABET_SIZE = 27;
+    /**
+     * @brief A constant that defines the maximum length of strings that can be
+     * processed by the bit-parallel kernel (the number of bits in a machine word)
+     *
+     */
+    const unsigned int BIT_PARALLEL_MAX_LENGTH = 64;
+
+    /**
+     * @brief Class that holds reusable scratch memory for the edit distance matrix,
+     * so that repeated calculations do not allocate memory
+     *
+     */
+    class Workspace
+    {
+    private:
+        /**
+         * @brief Flat storage for the cells of the matrix
+         *
+         */
+        std::vector<int> cells;
+
+    public:
+        /**
+         * @brief Default constructor
+         *
+         */
+        Workspace();
+
+        /**
+         * @brief Get storage for an edit distance matrix. The storage is reused
+         * between calls and only grows, so it is allocated once for the longest strings
+         *
+         * @param rows Number of rows in the matrix
+         * @param columns Number of columns in the matrix
+         * @return Pointer to the storage of rows * columns cells (row-major order)
+         */
+        int* matrix(std::size_t rows, std::size_t columns);
+    };
+
+    /**
+     * @brief Match masks of a string for the bit-parallel kernel
+     *
+     */
+    struct MatchMasks
+    {
+        /**
+         * @brief Bit i of peq[c] is set if a[i] matches the character c
+         * (taking wildcards into account)
+         *
+         */
+        std::uint64_t peq[ALPHABET_SIZE];
+        /**
+         * @brief Bit i of peq_exact[c] is set if a[i] is exactly the character c.
+         * The entry of the wildcard holds the positions of the wildcards
+         *
+         */
+        std::uint64_t peq_exact[ALPHABET_SIZE];
+        /**
+         * @brief Bit i of peq_before[c] is set if the character c appears exactly in a[0..i - 2]
+         *
+         */
+        std::uint64_t peq_before[ALPHABET_SIZE];
+        /**
+         * @brief Mask of valid rows (one bit per character of a)
+         *
+         */
+        std::uint64_t rows;
+    };
+
+    /**
+     * @brief Class that holds a query prepared for repeated edit distance calculations.
+     * The match masks and wildcard positions are built once, so comparing the query
+     * against each word only does the per-word work
+     *
+     */
+    class CompiledQuery
+    {
+    private:
+        /**
+         * @brief Text of the query
+         *
+         */
+        std::string text;
+        /**
+         * @brief Match masks of the query (only valid if the bit-parallel kernel is applicable)
+         *
+         */
+        MatchMasks masks;
+        /**
+         * @brief true if the query can be processed by the bit-parallel kernel
+         * (between 1 and BIT_PARALLEL_MAX_LENGTH valid characters), otherwise false
+         *
+         */
+        bool bit_parallel;
+
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param text Text of the query
+         */
+        explicit CompiledQuery(const std::string& text);
+
+        /**
+         * @brief Get the text of the query
+         *
+         * @return Text of the query
+         */
+        const std::string& getText() const;
+
+        /**
+         * @brief Get the match masks of the query
+         *
+         * @return Match masks of the query (only valid if isBitParallel() is true)
+         */
+        const MatchMasks& getMasks() const;
+
+        /**
+         * @brief Check if the query can be processed by the bit-parallel kernel
+         *
+         * @return true if the bit-parallel kernel is applicable, otherwise false
+         */
+        bool isBitParallel() const;
+
+        /**
+         * @brief Check if the query contains wildcards
+         *
+         * @return true if the query contains at least one wildcard, otherwise false
+         */
+        bool hasWildcards() const;
+    };
+
+    /**
+     * @brief Get the workspace of the calling thread. It is used by the overloads
+     * that do not take a workspace
+     *
+     * @return Workspace of the calling thread
+     */
+    Workspace& threadWorkspace();
 
     /**
      * @brief Map a character to an array index
@@ -40,6 +183,15 @@ namespace EditDistance
      */
     int charToIndex(char c);
 
+    /**
+     * @brief Check if every character of a string is supported by the edit distance
+     * calculations (lowercase letters and wildcards)
+     *
+     * @param s A string
+     * @return true if all characters are supported, false otherwise
+     */
+    bool isValidString(std::string_view s);
+
     /**
      * @brief Calculate edit distance between two strings using Damerau–Levenshtein distance
      * <https://en.wikipedia.org/wiki/Damerau–Levenshtein_distance>
@@ -49,6 +201,91 @@ namespace EditDistance
      * @return Edit distance
      */
     int editDistance(const std::string& a, const std::string& b);
+    /**
+     * @brief Calculate edit distance between two strings using Damerau–Levenshtein distance
+     * <https://en.wikipedia.org/wiki/Damerau–Levenshtein_distance>
+     *
+     * @param a First string
+     * @param b Second string
+     * @param workspace Scratch memory for the edit distance matrix
+     * @return Edit distance
+     */
+    int editDistance(const std::string& a, const std::string& b, Workspace& workspace);
+
+    /**
+     * @brief Calculate edit distance between two strings, but stop as soon as it is known
+     * to exceed the cap. Uses a banded (Ukkonen) matrix if the bit-parallel kernel is not
+     * applicable
+     *
+     * @param a First string
+     * @param b Second string
+     * @param cap Maximum edit distance of interest
+     * @return Edit distance if it does not exceed the cap, otherwise cap + 1
+     */
+    int editDistanceBounded(const std::string& a, const std::string& b, int cap);
+    /**
+     * @brief Calculate edit distance between two strings, but stop as soon as it is known
+     * to exceed the cap. Uses a banded (Ukkonen) matrix if the bit-parallel kernel is not
+     * applicable
+     *
+     * @param a First string
+     * @param b Second string
+     * @param cap Maximum edit distance of interest
+     * @param workspace Scratch memory for the edit distance matrix
+     * @return Edit distance if it does not exceed the cap, otherwise cap + 1
+     */
+    int editDistanceBounded(const std::string& a, const std::string& b, int cap,
+                            Workspace& workspace);
+    /**
+     * @brief Calculate edit distance between a compiled query and a string, but stop as soon
+     * as it is known to exceed the cap. Uses a banded (Ukkonen) matrix if the bit-parallel
+     * kernel is not applicable
+     *
+     * @param a Compiled query
+     * @param b Second string
+     * @param cap Maximum edit distance of interest
+     * @param workspace Scratch memory for the edit distance matrix
+     * @return Edit distance if it does not exceed the cap, otherwise cap + 1
+     */
+    int editDistanceBounded(const CompiledQuery& a, std::string_view b, int cap,
+                            Workspace& workspace);
+
+    /**
+     * @brief Calculate edit distance between two strings by filling the full
+     * Damerau–Levenshtein edit distance matrix
+     *
+     * @param a First string
+     * @param b Second string
+     * @return Edit distance
+     */
+    int editDistanceMatrix(const std::string& a, const std::string& b);
+    /**
+     * @brief Calculate edit distance between two strings by filling the full
+     * Damerau–Levenshtein edit distance matrix
+     *
+     * @param a First string
+     * @param b Second string
+     * @param workspace Scratch memory for the edit distance matrix
+     * @return Edit distance
+     */
+    int editDistanceMatrix(const std::string& a, const std::string& b, Workspace& workspace);
+
+    /**
+     * @brief Calculate edit distance between two strings using a bit-parallel kernel
+     * (Myers' algorithm with Hyyrö's transposition extension). Transpositions with characters
+     * inserted or deleted between the transposed ones are applied as a correction of the
+     * affected columns, so the result is equal to the one computed by editDistanceMatrix
+     *
+     * @param a First string (at most BIT_PARALLEL_MAX_LENGTH characters)
+     * @param b Second string (at most BIT_PARALLEL_MAX_LENGTH characters)
+     * @param cap Maximum edit distance of interest
+     * @param distance Edit distance if it does not exceed the cap, otherwise cap + 1
+     * (only set if the kernel was applicable)
+     * @return true if the kernel was applicable and the distance was calculated,
+     * false otherwise
+     */
+    bool editDistanceBitParallel(const std::string& a, const std::string& b, int cap,
+                                 int& distance);
 }
 
 #endif // EDIT_DISTANCE_H_INCLUDED
@@ -0,0 +1,511 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "flat_bk_tree.h"
+#include "bk_tree.h"
+#include "bk_tree_node.h"
+#include "edit_distance.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Magic bytes at the start of a memory-mappable BK-tree file
+ *
+ */
+static const char FLAT_BK_TREE_MAGIC[8] = {'T', 'R', 'B', 'K', 'T', 'R', 'E', 'E'};
+/**
+ * @brief Version of the memory-mappable BK-tree format
+ *
+ */
+static const std::uint32_t FLAT_BK_TREE_VERSION = 4;
+/**
+ * @brief Size of the file header in bytes
+ *
+ */
+static const std::size_t FLAT_BK_TREE_HEADER_SIZE = sizeof(FLAT_BK_TREE_MAGIC) + 4 * 4 + 2 * 8;
+
+// Records are stored in the file exactly as they are laid out in memory
+static_assert(sizeof(FlatBKTree::Node) == 8 * 4, "unexpected padding in FlatBKTree::Node");
+static_assert(sizeof(FlatBKTree::Edge) == 2 * 4, "unexpected padding in FlatBKTree::Edge");
+
+/**
+ * @brief Check if the host stores integers in little-endian byte order
+ *
+ * @return true if the host is little-endian, false otherwise
+ */
+static bool isLittleEndian()
+{
+    const std::uint32_t value = 1;
+    unsigned char first;
+    std::memcpy(&first, &value, 1);
+    return first == 1;
+}
+
+/**
+ * @brief Write a 32-bit integer in little-endian byte order
+ *
+ * @param os Output stream
+ * @param value Value to write
+ */
+static void writeUint32(std::ostream& os, std::uint32_t value)
+{
+    char bytes[4];
+
+    for(int i = 0; i < 4; i++)
+    {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+
+    os.write(bytes, sizeof(bytes));
+}
+
+/**
+ * @brief Write a 64-bit integer in little-endian byte order
+ *
+ * @param os Output stream
+ * @param value Value to write
+ */
+static void writeUint64(std::ostream& os, std::uint64_t value)
+{
+    writeUint32(os, static_cast<std::uint32_t>(value & 0xFFFFFFFF));
+    writeUint32(os, static_cast<std::uint32_t>(value >> 32));
+}
+
+/**
+ * @brief Read a 32-bit integer stored in little-endian byte order
+ *
+ * @param data Pointer to the first byte of the integer
+ * @return Value of the integer
+ */
+static std::uint32_t readUint32(const char* data)
+{
+    std::uint32_t value = 0;
+
+    for(int i = 0; i < 4; i++)
+    {
+        value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+
+    return value;
+}
+
+/**
+ * @brief Read a 64-bit integer stored in little-endian byte order
+ *
+ * @param data Pointer to the first byte of the integer
+ * @return Value of the integer
+ */
+static std::uint64_t readUint64(const char* data)
+{
+    return static_cast<std::uint64_t>(readUint32(data)) |
+           (static_cast<std::uint64_t>(readUint32(data + 4)) << 32);
+}
+
+/**
+ * @brief Check that the records of a tree only refer to existing records, their distances
+ * and lengths are within the limits of a word and the words only contain supported
+ * characters. Nodes are stored in breadth-first order with adjacent edges, so the edges
+ * of every node start right after the edges of the previous node and the k-th edge leads
+ * to the node k + 1
+ *
+ * @param nodes Node records
+ * @param node_count Number of nodes
+ * @param edges Edge records
+ * @param edge_count Number of edges
+ * @param words Word pool
+ * @param words_size Size of the word pool
+ * @return true if the tree is consistent, false otherwise
+ */
+static bool isValidTree(const FlatBKTree::Node* nodes, std::uint32_t node_count,
+                        const FlatBKTree::Edge* edges, std::uint32_t edge_count,
+                        const char* words, std::uint32_t words_size)
+{
+    // Characters are used as indices by the edit distance calculations
+    if(!EditDistance::isValidString(std::string_view(words, words_size)))
+    {
+        return false;
+    }
+
+    std::uint64_t next_edge = 0;
+
+    for(std::uint32_t i = 0; i < node_count; i++)
+    {
+        const FlatBKTree::Node& node = nodes[i];
+
+        if(std::uint64_t(node.word_offset) + node.word_length > words_size ||
+           node.edges_begin != next_edge || next_edge + node.edges_count > edge_count)
+        {
+            return false;
+        }
+
+        // Distances and lengths are used in signed arithmetic by the queries
+        if(node.max_child_distance > BK_TREE_MAX_WORD_LENGTH ||
+           node.min_length > node.max_length || node.max_length > BK_TREE_MAX_WORD_LENGTH)
+        {
+            return false;
+        }
+
+        for(std::uint32_t j = node.edges_begin; j < node.edges_begin + node.edges_count; j++)
+        {
+            // Edges are sorted by distance, which is never larger than the recorded maximum
+            if(edges[j].child != std::uint64_t(j) + 1 ||
+               (j > node.edges_begin && edges[j].distance <= edges[j - 1].distance) ||
+               edges[j].distance > node.max_child_distance)
+            {
+                return false;
+            }
+        }
+
+        next_edge += node.edges_count;
+    }
+
+    // Every node except the root is the child of exactly one edge
+    return next_edge == edge_count && (node_count == 0 ? edge_count == 0 :
+                                                         edge_count == node_count - 1);
+}
+
+/**
+ * @brief Default constructor
+ *
+ */
+FlatBKTree::FlatBKTree() :
+    node_storage(),
+    edge_storage(),
+    word_storage(),
+    file(nullptr),
+    nodes(nullptr),
+    node_count(0),
+    edges(nullptr),
+    words(nullptr),
+    seed(0),
+    cost(0.0)
+{
+}
+
+/**
+ * @brief Create a frozen copy of a BK-tree
+ *
+ * @param tree BK-tree
+ */
+FlatBKTree::FlatBKTree(const BKTree& tree) : FlatBKTree()
+{
+    this->seed = tree.getSeed();
+    this->cost = tree.getCost();
+
+    if(tree.getRoot() == nullptr)
+    {
+        return;
+    }
+
+    // Nodes are numbered in the order they are queued, so the index of a child
+    // is known as soon as it is queued
+    std::vector<const BKTreeNode*> queue;
+    queue.push_back(tree.getRoot());
+
+    for(std::size_t i = 0; i < queue.size(); i++)
+    {
+        const BKTreeNode* source = queue[i];
+        std::string word = source->getWord();
+
+        Node node;
+        node.word_offset = static_cast<std::uint32_t>(this->word_storage.size());
+        node.word_length = static_cast<std::uint32_t>(word.size());
+        node.edges_begin = static_cast<std::uint32_t>(this->edge_storage.size());
+        node.max_child_distance = static_cast<std::uint32_t>(source->getMaxChildDistance());
+        node.min_length = static_cast<std::uint32_t>(source->getMinLength());
+        node.max_length = static_cast<std::uint32_t>(source->getMaxLength());
+        node.deleted = source->isDeleted() ? 1 : 0;
+
+        // Child distances are sorted, so are the edges
+        for(int distance : source->getChildDistances())
+        {
+            Edge edge;
+            edge.distance = static_cast<std::uint32_t>(distance);
+            edge.child = static_cast<std::uint32_t>(queue.size());
+
+            this->edge_storage.push_back(edge);
+            queue.push_back(source->getChild(distance));
+        }
+
+        node.edges_count = static_cast<std::uint32_t>(this->edge_storage.size()) -
+                           node.edges_begin;
+
+        this->node_storage.push_back(node);
+        this->word_storage.insert(this->word_storage.end(), word.begin(), word.end());
+    }
+
+    this->nodes = this->node_storage.data();
+    this->node_count = static_cast<std::uint32_t>(this->node_storage.size());
+    this->edges = this->edge_storage.data();
+    this->words = this->word_storage.data();
+}
+
+/**
+ * @brief Get the number of nodes in the tree, including the ones with a deleted word
+ *
+ * @return Number of nodes
+ */
+std::size_t FlatBKTree::size() const
+{
+    return this->node_count;
+}
+
+/**
+ * @brief Get the seed of the random insertion order the tree was built with
+ *
+ * @return Seed
+ */
+std::uint64_t FlatBKTree::getSeed() const
+{
+    return this->seed;
+}
+
+/**
+ * @brief Get the estimated cost of a query
+ *
+ * @return Average number of visited nodes, 0 if it is unknown
+ */
+double FlatBKTree::getCost() const
+{
+    return this->cost;
+}
+
+/**
+ * @brief Find all words similar to the query within the tolerance value
+ *
+ * @param query Query
+ * @param tolerance Tolerance value (max edit distance)
+ * @return A list of matching words
+ */
+std::vector<std::string> FlatBKTree::find(const std::string& query, unsigned int tolerance) const
+{
+    std::vector<std::string> results;
+    this->find(EditDistance::CompiledQuery(query), tolerance, results,
+               EditDistance::threadWorkspace());
+    return results;
+}
+
+/**
+ * @brief Find all words similar to the query within the tolerance value
+ *
+ * @param query Compiled query
+ * @param tolerance Tolerance value (max edit distance)
+ * @param results A collection with results to pass
+ * @param workspace Scratch memory for edit distance calculations
+ */
+void FlatBKTree::find(const EditDistance::CompiledQuery& query, unsigned int tolerance,
+                      std::vector<std::string>& results,
+                      EditDistance::Workspace& workspace) const
+{
+    if(this->node_count == 0)
+    {
+        return;
+    }
+
+    // Indices of the nodes that are waiting to be visited
+    std::vector<std::uint32_t> pending;
+    pending.push_back(0);
+
+    // The edit distance is at least the difference of the lengths (a wildcard stands for
+    // exactly one character), so subtrees without words of a close length are skipped
+    std::size_t length = query.getText().length();
+    std::size_t min_length = length - std::min<std::size_t>(length, tolerance);
+    std::size_t max_length = length + tolerance;
+
+    while(!pending.empty())
+    {
+        const Node& node = this->nodes[pending.back()];
+        pending.pop_back();
+
+        if(node.max_length < min_length || node.min_length > max_length)
+        {
+            continue;
+        }
+
+        std::string_view word = this->getWord(node);
+
+        // Children are only visited if their distance is within the tolerance of the distance
+        // to this node, so the exact distance is not needed once it exceeds this cap
+        int cap = static_cast<int>(tolerance + node.max_child_distance);
+        int distance = EditDistance::editDistanceBounded(query, word, cap, workspace);
+
+        if(distance <= static_cast<int>(tolerance) && !node.deleted)
+        {
+            results.emplace_back(word);
+        }
+
+        int min_dist = distance - static_cast<int>(tolerance);
+        int max_dist = distance + static_cast<int>(tolerance);
+
+        const Edge* begin = this->edges + node.edges_begin;
+        const Edge* end = begin + node.edges_count;
+
+        // Edges are sorted by distance, so the matching ones form a contiguous range
+        const Edge* it = std::lower_bound(begin, end, min_dist,
+                                          [](const Edge& edge, int value)
+                                          {
+                                              return static_cast<int>(edge.distance) < value;
+                                          });
+
+        for(; it != end && static_cast<int>(it->distance) <= max_dist; it++)
+        {
+            pending.push_back(it->child);
+        }
+    }
+}
+
+/**
+ * @brief Write the tree in the memory-mappable format
+ *
+ * @param os Output stream
+ */
+void FlatBKTree::serialize(std::ostream& os) const
+{
+    std::uint32_t edge_count = 0;
+    std::uint32_t words_size = 0;
+
+    if(this->node_count > 0)
+    {
+        const Node& last = this->nodes[this->node_count - 1];
+        edge_count = last.edges_begin + last.edges_count;
+        words_size = last.word_offset + last.word_length;
+    }
+
+    os.write(FLAT_BK_TREE_MAGIC, sizeof(FLAT_BK_TREE_MAGIC));
+    writeUint32(os, FLAT_BK_TREE_VERSION);
+    writeUint32(os, this->node_count);
+    writeUint32(os, edge_count);
+    writeUint32(os, words_size);
+
+    std::uint64_t cost_bits;
+    std::memcpy(&cost_bits, &this->cost, sizeof(cost_bits));
+    writeUint64(os, this->seed);
+    writeUint64(os, cost_bits);
+
+    for(std::uint32_t i = 0; i < this->node_count; i++)
+    {
+        const Node& node = this->nodes[i];
+        writeUint32(os, node.word_offset);
+        writeUint32(os, node.word_length);
+        writeUint32(os, node.edges_begin);
+        writeUint32(os, node.edges_count);
+        writeUint32(os, node.max_child_distance);
+        writeUint32(os, node.min_length);
+        writeUint32(os, node.max_length);
+        writeUint32(os, node.deleted);
+    }
+
+    for(std::uint32_t i = 0; i < edge_count; i++)
+    {
+        writeUint32(os, this->edges[i].distance);
+        writeUint32(os, this->edges[i].child);
+    }
+
+    os.write(this->words, words_size);
+}
+
+/**
+ * @brief Map a file written by serialize() into memory. The tree is queried
+ * in place, without reading the nodes
+ *
+ * @param filepath Path to the file
+ */
+void FlatBKTree::map(const std::string& filepath)
+{
+    // Records are used in place, so their byte order must match the host
+    if(!isLittleEndian())
+    {
+        throw std::runtime_error("memory-mapped BK-tree requires a little-endian host");
+    }
+
+    std::unique_ptr<MappedFile> mapped = std::make_unique<MappedFile>(filepath);
+    const char* data = mapped->data();
+    std::size_t size = mapped->size();
+
+    if(size < FLAT_BK_TREE_HEADER_SIZE ||
+       std::memcmp(data, FLAT_BK_TREE_MAGIC, sizeof(FLAT_BK_TREE_MAGIC)) != 0)
+    {
+        throw std::runtime_error("invalid BK-tree file " + filepath);
+    }
+
+    const char* header = data + sizeof(FLAT_BK_TREE_MAGIC);
+
+    if(readUint32(header) != FLAT_BK_TREE_VERSION)
+    {
+        throw std::runtime_error("unsupported BK-tree file version in " + filepath);
+    }
+
+    std::uint32_t node_count = readUint32(header + 4);
+    std::uint32_t edge_count = readUint32(header + 8);
+    std::uint32_t words_size = readUint32(header + 12);
+    std::uint64_t seed = readUint64(header + 16);
+    std::uint64_t cost_bits = readUint64(header + 24);
+
+    std::size_t nodes_offset = FLAT_BK_TREE_HEADER_SIZE;
+    std::size_t edges_offset = nodes_offset + std::size_t(node_count) * sizeof(Node);
+    std::size_t words_offset = edges_offset + std::size_t(edge_count) * sizeof(Edge);
+
+    if(words_offset + words_size != size)
+    {
+        throw std::runtime_error("invalid BK-tree file " + filepath);
+    }
+
+    const Node* nodes = reinterpret_cast<const Node*>(data + nodes_offset);
+    const Edge* edges = reinterpret_cast<const Edge*>(data + edges_offset);
+
+    // Records are used without bounds checks by the queries, so they are checked once here
+    if(!isValidTree(nodes, node_count, edges, edge_count, data + words_offset, words_size))
+    {
+        throw std::runtime_error("invalid BK-tree file " + filepath);
+    }
+
+    this->node_storage.clear();
+    this->edge_storage.clear();
+    this->word_storage.clear();
+
+    this->file = std::move(mapped);
+    this->nodes = nodes;
+    this->node_count = node_count;
+    this->edges = edges;
+    this->words = data + words_offset;
+    this->seed = seed;
+    std::memcpy(&this->cost, &cost_bits, sizeof(this->cost));
+}
+
+/**
+ * @brief Get the word of a node
+ *
+ * @param node Node
+ * @return The word of the node (a view into the word pool)
+ */
+std::string_view FlatBKTree::getWord(const Node& node) const
+{
+    return std::string_view(this->words + node.word_offset, node.word_length);
+}
@@ -0,0 +1,253 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FLAT_BK_TREE_H_INCLUDED
+#define FLAT_BK_TREE_H_INCLUDED
+
+#include "bk_tree.h"
+#include "edit_distance.h"
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Class that represents a frozen (read-only) BK-tree stored in contiguous arrays.
+ * Nodes are stored in breadth-first order, words are stored in a single pool and
+ * the edges of every node are sorted by edit distance.
+ *
+ * The arrays are either owned by the tree or point into a memory-mapped file, which
+ * is queried in place. The file starts with a header (8-byte magic, then the format
+ * version, the number of nodes, the number of edges and the size of the word pool as
+ * 32-bit integers, then the seed as a 64-bit integer and the cost as a 64-bit IEEE 754
+ * number), followed by the node records, the edge records and the word pool.
+ * All integers are little-endian
+ *
+ */
+class FlatBKTree
+{
+public:
+    /**
+     * @brief A node of the tree
+     *
+     */
+    struct Node
+    {
+        /**
+         * @brief Offset of the word in the word pool
+         *
+         */
+        std::uint32_t word_offset;
+        /**
+         * @brief Length of the word
+         *
+         */
+        std::uint32_t word_length;
+        /**
+         * @brief Index of the first edge of the node
+         *
+         */
+        std::uint32_t edges_begin;
+        /**
+         * @brief Number of edges of the node
+         *
+         */
+        std::uint32_t edges_count;
+        /**
+         * @brief The largest edit distance among the children of the node
+         * (0 if the node has no children)
+         *
+         */
+        std::uint32_t max_child_distance;
+        /**
+         * @brief The shortest word length in the subtree of the node
+         *
+         */
+        std::uint32_t min_length;
+        /**
+         * @brief The longest word length in the subtree of the node
+         *
+         */
+        std::uint32_t max_length;
+        /**
+         * @brief 1 if the word of the node is deleted (the node is only a pivot
+         * of the search), 0 otherwise
+         *
+         */
+        std::uint32_t deleted;
+    };
+
+    /**
+     * @brief An edge between a node and its child
+     *
+     */
+    struct Edge
+    {
+        /**
+         * @brief Edit distance between the words of the node and the child
+         *
+         */
+        std::uint32_t distance;
+        /**
+         * @brief Index of the child node
+         *
+         */
+        std::uint32_t child;
+    };
+
+private:
+    /**
+     * @brief Storage for the nodes if the tree is not memory-mapped
+     *
+     */
+    std::vector<Node> node_storage;
+    /**
+     * @brief Storage for the edges if the tree is not memory-mapped
+     *
+     */
+    std::vector<Edge> edge_storage;
+    /**
+     * @brief Storage for the word pool if the tree is not memory-mapped
+     *
+     */
+    std::vector<char> word_storage;
+    /**
+     * @brief Memory-mapped file (nullptr if the tree is not memory-mapped)
+     *
+     */
+    std::unique_ptr<MappedFile> file;
+    /**
+     * @brief Nodes in breadth-first order (the root is the first node)
+     *
+     */
+    const Node* nodes;
+    /**
+     * @brief Number of nodes
+     *
+     */
+    std::uint32_t node_count;
+    /**
+     * @brief Edges of all nodes. The edges of a node are adjacent and sorted by edit distance
+     *
+     */
+    const Edge* edges;
+    /**
+     * @brief Words of all nodes stored one after another
+     *
+     */
+    const char* words;
+    /**
+     * @brief Seed of the random insertion order the tree was built with
+     *
+     */
+    std::uint64_t seed;
+    /**
+     * @brief Estimated cost of a query (average number of visited nodes),
+     * 0 if it is unknown
+     *
+     */
+    double cost;
+
+public:
+    /**
+     * @brief Default constructor
+     *
+     */
+    FlatBKTree();
+    /**
+     * @brief Create a frozen copy of a BK-tree
+     *
+     * @param tree BK-tree
+     */
+    explicit FlatBKTree(const BKTree& tree);
+
+    FlatBKTree(const FlatBKTree&) = delete;
+    FlatBKTree& operator=(const FlatBKTree&) = delete;
+
+    /**
+     * @brief Get the number of nodes in the tree, including the ones with a deleted word
+     *
+     * @return Number of nodes
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Get the seed of the random insertion order the tree was built with
+     *
+     * @return Seed
+     */
+    std::uint64_t getSeed() const;
+
+    /**
+     * @brief Get the estimated cost of a query
+     *
+     * @return Average number of visited nodes, 0 if it is unknown
+     */
+    double getCost() const;
+
+    /**
+     * @brief Find all words similar to the query within the tolerance value
+     *
+     * @param query Query
+     * @param tolerance Tolerance value (max edit distance)
+     * @return A list of matching words
+     */
+    std::vector<std::string> find(const std::string& query, unsigned int tolerance = 2) const;
+    /**
+     * @brief Find all words similar to the query within the tolerance value
+     *
+     * @param query Compiled query
+     * @param tolerance Tolerance value (max edit distance)
+     * @param results A collection with results to pass
+     * @param workspace Scratch memory for edit distance calculations
+     */
+    void find(const EditDistance::CompiledQuery& query, unsigned int tolerance,
+              std::vector<std::string>& results, EditDistance::Workspace& workspace) const;
+
+    /**
+     * @brief Write the tree in the memory-mappable format
+     *
+     * @param os Output stream
+     */
+    void serialize(std::ostream& os) const;
+
+    /**
+     * @brief Map a file written by serialize() into memory. The tree is queried
+     * in place, without reading the nodes
+     *
+     * @param filepath Path to the file
+     */
+    void map(const std::string& filepath);
+
+private:
+    /**
+     * @brief Get the word of a node
+     *
+     * @param node Node
+     * @return The word of the node (a view into the word pool)
+     */
+    std::string_view getWord(const Node& node) const;
+};
+
+#endif // FLAT_BK_TREE_H_INCLUDED
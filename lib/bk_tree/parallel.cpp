@@ -0,0 +1,235 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Range of indices owned by one thread of the pool
+ *
+ */
+struct WorkRange
+{
+    /**
+     * @brief Guards the bounds of the range
+     *
+     */
+    std::mutex mutex;
+    /**
+     * @brief First index that has not been taken yet
+     *
+     */
+    std::size_t begin = 0;
+    /**
+     * @brief End of the range (exclusive)
+     *
+     */
+    std::size_t end = 0;
+};
+
+/**
+ * @brief Take the next index from the front of a range
+ *
+ * @param range Range
+ * @param index Taken index
+ * @return true if an index was taken, false if the range is empty
+ */
+static bool takeFront(WorkRange& range, std::size_t& index)
+{
+    std::lock_guard<std::mutex> lock(range.mutex);
+
+    if(range.begin >= range.end)
+    {
+        return false;
+    }
+
+    index = range.begin++;
+    return true;
+}
+
+/**
+ * @brief Steal the back half of the largest range of the other threads
+ *
+ * @param ranges Ranges of all threads
+ * @param thief Index of the thread that steals
+ * @return true if some work was stolen, false if there is no work left
+ */
+static bool steal(std::vector<WorkRange>& ranges, std::size_t thief)
+{
+    while(true)
+    {
+        // Find the victim by locking every range in turn. The sizes may change as soon as
+        // a lock is released, so the chosen range is checked again under the final lock
+        std::size_t victim = ranges.size();
+        std::size_t largest = 0;
+
+        for(std::size_t i = 0; i < ranges.size(); i++)
+        {
+            if(i == thief)
+            {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(ranges[i].mutex);
+            std::size_t remaining = ranges[i].end - std::min(ranges[i].begin, ranges[i].end);
+
+            if(remaining > largest)
+            {
+                largest = remaining;
+                victim = i;
+            }
+        }
+
+        if(victim == ranges.size())
+        {
+            return false;
+        }
+
+        std::scoped_lock lock(ranges[victim].mutex, ranges[thief].mutex);
+        WorkRange& from = ranges[victim];
+
+        // The victim may have finished its range in the meantime
+        if(from.begin >= from.end)
+        {
+            continue;
+        }
+
+        std::size_t middle = from.begin + (from.end - from.begin) / 2;
+
+        ranges[thief].begin = middle;
+        ranges[thief].end = from.end;
+        from.end = middle;
+        return true;
+    }
+}
+
+/**
+ * @brief Get the number of threads to use
+ *
+ * @param threads Requested number of threads (0 means one per hardware thread)
+ * @return Number of threads (at least 1)
+ */
+unsigned int Parallel::threadCount(unsigned int threads)
+{
+    if(threads == 0)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+
+    return std::max(threads, 1u);
+}
+
+/**
+ * @brief Run a task for every index in [0, count) on a work-stealing pool.
+ * Every thread starts with an equal range of indices and takes them from the front
+ * of its own range. A thread that runs out of work steals the back half of the
+ * largest remaining range of another thread. The calling thread takes part in the work.
+ * If a task throws, the remaining indices are skipped and the first exception is
+ * rethrown once all threads have stopped
+ *
+ * @param count Number of indices
+ * @param threads Number of threads (0 means one per hardware thread)
+ * @param task Task to run for every index
+ */
+void Parallel::forEach(std::size_t count, unsigned int threads,
+                       const std::function<void(std::size_t)>& task)
+{
+    std::size_t workers = std::min<std::size_t>(threadCount(threads), count);
+
+    if(workers <= 1)
+    {
+        for(std::size_t i = 0; i < count; i++)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    std::vector<WorkRange> ranges(workers);
+
+    for(std::size_t i = 0; i < workers; i++)
+    {
+        ranges[i].begin = count * i / workers;
+        ranges[i].end = count * (i + 1) / workers;
+    }
+
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&](std::size_t worker)
+    {
+        std::size_t index;
+
+        while(!failed.load(std::memory_order_relaxed))
+        {
+            if(!takeFront(ranges[worker], index))
+            {
+                if(!steal(ranges, worker))
+                {
+                    return;
+                }
+                continue;
+            }
+
+            try
+            {
+                task(index);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+
+                if(!error)
+                {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+
+    for(std::size_t i = 1; i < workers; i++)
+    {
+        pool.emplace_back(work, i);
+    }
+
+    work(0);
+
+    for(std::thread& thread : pool)
+    {
+        thread.join();
+    }
+
+    if(error)
+    {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,52 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PARALLEL_H_INCLUDED
+#define PARALLEL_H_INCLUDED
+
+#include <cstddef>
+#include <functional>
+
+namespace Parallel
+{
+    /**
+     * @brief Get the number of threads to use
+     *
+     * @param threads Requested number of threads (0 means one per hardware thread)
+     * @return Number of threads (at least 1)
+     */
+    unsigned int threadCount(unsigned int threads);
+
+    /**
+     * @brief Run a task for every index in [0, count) on a work-stealing pool.
+     * Every thread starts with an equal range of indices and takes them from the front
+     * of its own range. A thread that runs out of work steals the back half of the
+     * largest remaining range of another thread. The calling thread takes part in the work.
+     * If a task throws, the remaining indices are skipped and the first exception is
+     * rethrown once all threads have stopped
+     *
+     * @param count Number of indices
+     * @param threads Number of threads (0 means one per hardware thread)
+     * @param task Task to run for every index
+     */
+    void forEach(std::size_t count, unsigned int threads,
+                 const std::function<void(std::size_t)>& task);
+}
+
+#endif // PARALLEL_H_INCLUDED
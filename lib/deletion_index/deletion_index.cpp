@@ -0,0 +1,368 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "deletion_index.h"
+#include "byte_reader.h"
+#include "edit_distance.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Magic bytes at the start of a serialized deletion index
+ *
+ */
+static const char DELETION_INDEX_MAGIC[4] = {'T', 'R', 'D', 'I'};
+/**
+ * @brief Version of the serialized deletion index format
+ *
+ */
+static const unsigned int DELETION_INDEX_FORMAT_VERSION = 1;
+
+/**
+ * @brief Get the FNV-1a hash of a string
+ *
+ * @param s A string
+ * @return Hash of the string
+ */
+static std::uint64_t hashString(const std::string& s)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+
+    for(char c : s)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Constructor
+ *
+ * @param max_deletions Maximum number of deletions indexed for every word
+ * (at most DELETION_INDEX_MAX_DELETIONS)
+ * @param prefix_length Number of leading characters of a word that deletions are
+ * generated from (0 means the whole word)
+ */
+DeletionIndex::DeletionIndex(unsigned int max_deletions, unsigned int prefix_length)
+    : max_deletions(max_deletions), prefix_length(prefix_length), words(), deletions()
+{
+    if(max_deletions > DELETION_INDEX_MAX_DELETIONS)
+    {
+        throw std::runtime_error("maximum number of deletions of a deletion index exceeds " +
+                                 std::to_string(DELETION_INDEX_MAX_DELETIONS));
+    }
+}
+
+/**
+ * @brief Get the maximum number of deletions indexed for every word
+ *
+ * @return Maximum number of deletions
+ */
+unsigned int DeletionIndex::getMaxDeletions() const
+{
+    return this->max_deletions;
+}
+
+/**
+ * @brief Get the number of leading characters of a word that deletions are generated from
+ *
+ * @return Prefix length (0 means the whole word)
+ */
+unsigned int DeletionIndex::getPrefixLength() const
+{
+    return this->prefix_length;
+}
+
+/**
+ * @brief Get the number of indexed words
+ *
+ * @return Number of words
+ */
+std::size_t DeletionIndex::size() const
+{
+    return this->words.size();
+}
+
+/**
+ * @brief Insert a word into the index
+ *
+ * @param word A word to insert
+ */
+void DeletionIndex::insert(const std::string& word)
+{
+    // A duplicate is indexed under its own prefix without deletions
+    std::string prefix = word.substr(0, this->prefix_length ? this->prefix_length
+                                                            : word.length());
+    auto it = this->deletions.find(hashString(prefix));
+
+    if(it != this->deletions.end())
+    {
+        for(std::uint32_t index : it->second)
+        {
+            if(this->words[index] == word)
+            {
+                return;
+            }
+        }
+    }
+
+    this->words.push_back(word);
+    this->indexWord(static_cast<std::uint32_t>(this->words.size() - 1));
+}
+
+/**
+ * @brief Find all words similar to the query within the tolerance value
+ *
+ * @param query Query
+ * @param tolerance Tolerance value (max edit distance)
+ * @return A list of matching words
+ */
+std::vector<std::string> DeletionIndex::find(const std::string& query,
+                                             unsigned int tolerance) const
+{
+    EditDistance::Workspace& workspace = EditDistance::threadWorkspace();
+    std::vector<std::string> results;
+
+    // A wildcard matches any character, but the deletions of the query only meet the
+    // deletions of a word where the wildcard is either deleted or substituted, so every
+    // wildcard in the prefix costs one more deletion
+    std::size_t length = this->prefix_length ? std::min<std::size_t>(query.length(),
+                                                                      this->prefix_length)
+                                             : query.length();
+    std::size_t needed = tolerance + std::count(query.begin(), query.begin() + length, '*');
+
+    if(needed > this->max_deletions)
+    {
+        // The index cannot find all candidates, so every word is verified
+        for(const std::string& word : this->words)
+        {
+            int distance = EditDistance::editDistance(query, word, workspace);
+
+            if(distance <= static_cast<int>(tolerance))
+            {
+                results.push_back(word);
+            }
+        }
+
+        return results;
+    }
+
+    std::vector<std::uint32_t> candidates;
+
+    for(std::uint64_t hash : this->generateDeletions(query, static_cast<unsigned int>(needed)))
+    {
+        auto it = this->deletions.find(hash);
+
+        if(it != this->deletions.end())
+        {
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for(std::uint32_t index : candidates)
+    {
+        int distance = EditDistance::editDistance(query, this->words[index], workspace);
+
+        if(distance <= static_cast<int>(tolerance))
+        {
+            results.push_back(this->words[index]);
+        }
+    }
+
+    return results;
+}
+
+/**
+ * @brief Serialize the index. Only the settings and the words are written,
+ * the deletions are generated again by deserialize()
+ *
+ * @param os Output stream
+ */
+void DeletionIndex::serialize(std::ostream& os) const
+{
+    // Write the header: magic bytes, the version of the format, the settings
+    // and the number of words
+    unsigned int version = DELETION_INDEX_FORMAT_VERSION;
+    unsigned int max_deletions = this->max_deletions;
+    unsigned int prefix_length = this->prefix_length;
+    unsigned int word_count = static_cast<unsigned int>(this->words.size());
+    os.write(DELETION_INDEX_MAGIC, sizeof(DELETION_INDEX_MAGIC));
+    os.write(reinterpret_cast<char*>(&version), sizeof(version));
+    os.write(reinterpret_cast<char*>(&max_deletions), sizeof(max_deletions));
+    os.write(reinterpret_cast<char*>(&prefix_length), sizeof(prefix_length));
+    os.write(reinterpret_cast<char*>(&word_count), sizeof(word_count));
+
+    // Write every word after its length
+    for(const std::string& word : this->words)
+    {
+        unsigned int length = static_cast<unsigned int>(word.length());
+        os.write(reinterpret_cast<char*>(&length), sizeof(length));
+        os.write(word.data(), length);
+    }
+}
+
+/**
+ * @brief Deserialize the index
+ *
+ * @param is Input stream
+ */
+void DeletionIndex::deserialize(std::istream& is)
+{
+    ByteReader::parseStream(is, [this](ByteReader& reader) { this->deserialize(reader); });
+}
+
+/**
+ * @brief Deserialize the index from memory. The index is only replaced
+ * if the data is valid
+ *
+ * @param reader Reader of the serialized data
+ */
+void DeletionIndex::deserialize(ByteReader& reader)
+{
+    if(!reader.startsWith(DELETION_INDEX_MAGIC, sizeof(DELETION_INDEX_MAGIC)))
+    {
+        throw std::runtime_error("invalid deletion index data");
+    }
+
+    reader.read(sizeof(DELETION_INDEX_MAGIC));
+    unsigned int version = reader.readValue<unsigned int>();
+
+    if(version > DELETION_INDEX_FORMAT_VERSION)
+    {
+        throw std::runtime_error("unsupported deletion index format version " +
+                                 std::to_string(version));
+    }
+
+    unsigned int max_deletions = reader.readValue<unsigned int>();
+    unsigned int prefix_length = reader.readValue<unsigned int>();
+    unsigned int word_count = reader.readValue<unsigned int>();
+
+    // Every word takes at least four bytes for its length, which bounds the count
+    // of a corrupt file
+    if(max_deletions > DELETION_INDEX_MAX_DELETIONS ||
+       word_count > reader.remaining() / sizeof(unsigned int))
+    {
+        throw std::runtime_error("invalid deletion index data");
+    }
+
+    // The index is built aside, so a corrupt file leaves the current one intact
+    DeletionIndex index(max_deletions, prefix_length);
+    index.words.reserve(word_count);
+
+    for(unsigned int i = 0; i < word_count; i++)
+    {
+        unsigned int length = reader.readValue<unsigned int>();
+
+        if(length > reader.remaining())
+        {
+            throw std::runtime_error("invalid deletion index data");
+        }
+
+        index.words.emplace_back(reader.read(length), length);
+
+        // Characters are used as indices by the edit distance calculations
+        if(!EditDistance::isValidString(index.words.back()))
+        {
+            throw std::runtime_error("invalid deletion index data");
+        }
+
+        index.indexWord(i);
+    }
+
+    *this = std::move(index);
+}
+
+/**
+ * @brief Generate all distinct strings obtained by deleting up to the given number of
+ * characters from the prefix of a string
+ *
+ * @param s A string
+ * @param max_deletions Maximum number of deletions
+ * @return Hashes of the strings (including the prefix itself)
+ */
+std::vector<std::uint64_t> DeletionIndex::generateDeletions(const std::string& s,
+                                                            unsigned int max_deletions) const
+{
+    std::string prefix = s.substr(0, this->prefix_length ? this->prefix_length : s.length());
+
+    // Strings of the current number of deletions, every string is expanded only once
+    std::unordered_set<std::string> seen = {prefix};
+    std::vector<std::string> level = {prefix};
+
+    for(unsigned int d = 0; d < max_deletions && !level.empty(); d++)
+    {
+        std::vector<std::string> next;
+
+        for(const std::string& current : level)
+        {
+            for(std::size_t i = 0; i < current.length(); i++)
+            {
+                std::string deleted = current.substr(0, i) + current.substr(i + 1);
+
+                if(seen.insert(deleted).second)
+                {
+                    next.push_back(std::move(deleted));
+                }
+            }
+        }
+
+        level = std::move(next);
+    }
+
+    std::vector<std::uint64_t> hashes;
+    hashes.reserve(seen.size());
+
+    for(const std::string& deleted : seen)
+    {
+        hashes.push_back(hashString(deleted));
+    }
+
+    // Different strings may share a hash
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+    return hashes;
+}
+
+/**
+ * @brief Add a word to the deletions without checking for duplicates
+ *
+ * @param index Index of the word
+ */
+void DeletionIndex::indexWord(std::uint32_t index)
+{
+    for(std::uint64_t hash : this->generateDeletions(this->words[index], this->max_deletions))
+    {
+        this->deletions[hash].push_back(index);
+    }
+}
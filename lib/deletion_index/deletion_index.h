@@ -0,0 +1,168 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DELETION_INDEX_H_INCLUDED
+#define DELETION_INDEX_H_INCLUDED
+
+#include "byte_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The largest supported maximum number of deletions. The number of deletions
+ * generated for every word grows exponentially with it
+ *
+ */
+const unsigned int DELETION_INDEX_MAX_DELETIONS = 4;
+
+/**
+ * @brief Class that represents a symmetric deletion index (SymSpell). Every word is indexed
+ * under all strings obtained by deleting up to max_deletions characters from its prefix.
+ * Two words within edit distance k share such a string with at most k deletions on each
+ * side, so a query only looks up its own deletions and verifies the candidates with
+ * EditDistance::editDistance.
+ *
+ * The maximum number of deletions and the prefix length trade memory for speed: fewer
+ * deletions and shorter prefixes give a smaller index, but more candidates to verify.
+ * Results are exact for any setting, queries that need more deletions than indexed
+ * are answered by a linear scan
+ *
+ */
+class DeletionIndex
+{
+private:
+    /**
+     * @brief Maximum number of deletions indexed for every word
+     *
+     */
+    unsigned int max_deletions;
+    /**
+     * @brief Number of leading characters of a word that deletions are generated from
+     * (0 means the whole word)
+     *
+     */
+    unsigned int prefix_length;
+    /**
+     * @brief Indexed words
+     *
+     */
+    std::vector<std::string> words;
+    /**
+     * @brief Indices of the words by the hash of their deletions
+     *
+     */
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> deletions;
+
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param max_deletions Maximum number of deletions indexed for every word
+     * (at most DELETION_INDEX_MAX_DELETIONS)
+     * @param prefix_length Number of leading characters of a word that deletions are
+     * generated from (0 means the whole word)
+     */
+    explicit DeletionIndex(unsigned int max_deletions = 2, unsigned int prefix_length = 7);
+
+    /**
+     * @brief Get the maximum number of deletions indexed for every word
+     *
+     * @return Maximum number of deletions
+     */
+    unsigned int getMaxDeletions() const;
+
+    /**
+     * @brief Get the number of leading characters of a word that deletions are generated from
+     *
+     * @return Prefix length (0 means the whole word)
+     */
+    unsigned int getPrefixLength() const;
+
+    /**
+     * @brief Get the number of indexed words
+     *
+     * @return Number of words
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Insert a word into the index
+     *
+     * @param word A word to insert
+     */
+    void insert(const std::string& word);
+
+    /**
+     * @brief Find all words similar to the query within the tolerance value
+     *
+     * @param query Query
+     * @param tolerance Tolerance value (max edit distance)
+     * @return A list of matching words
+     */
+    std::vector<std::string> find(const std::string& query, unsigned int tolerance = 2) const;
+
+    /**
+     * @brief Serialize the index. Only the settings and the words are written,
+     * the deletions are generated again by deserialize()
+     *
+     * @param os Output stream
+     */
+    void serialize(std::ostream& os) const;
+
+    /**
+     * @brief Deserialize the index
+     *
+     * @param is Input stream
+     */
+    void deserialize(std::istream& is);
+    /**
+     * @brief Deserialize the index from memory. The index is only replaced
+     * if the data is valid
+     *
+     * @param reader Reader of the serialized data
+     */
+    void deserialize(ByteReader& reader);
+
+private:
+    /**
+     * @brief Generate all distinct strings obtained by deleting up to the given number of
+     * characters from the prefix of a string
+     *
+     * @param s A string
+     * @param max_deletions Maximum number of deletions
+     * @return Hashes of the strings (including the prefix itself)
+     */
+    std::vector<std::uint64_t> generateDeletions(const std::string& s,
+                                                 unsigned int max_deletions) const;
+
+    /**
+     * @brief Add a word to the deletions without checking for duplicates
+     *
+     * @param index Index of the word
+     */
+    void indexWord(std::uint32_t index);
+};
+
+#endif // DELETION_INDEX_H_INCLUDED
@@ -0,0 +1,162 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "byte_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ios>
+#include <istream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Constructor
+ *
+ * @param data Data to parse (must outlive the reader)
+ * @param size Size of the data in bytes
+ */
+ByteReader::ByteReader(const char* data, std::size_t size) :
+    begin(data), cursor(data), end(data + size)
+{
+}
+
+/**
+ * @brief Get the number of bytes read so far
+ *
+ * @return Number of bytes read
+ */
+std::size_t ByteReader::position() const
+{
+    return static_cast<std::size_t>(this->cursor - this->begin);
+}
+
+/**
+ * @brief Get the number of bytes left
+ *
+ * @return Number of bytes left
+ */
+std::size_t ByteReader::remaining() const
+{
+    return static_cast<std::size_t>(this->end - this->cursor);
+}
+
+/**
+ * @brief Check if the data at the current position starts with the given bytes
+ *
+ * @param bytes Bytes to compare
+ * @param count Number of bytes
+ * @return true if the next bytes are equal, false otherwise (or if there are fewer left)
+ */
+bool ByteReader::startsWith(const char* bytes, std::size_t count) const
+{
+    return this->remaining() >= count && std::memcmp(this->cursor, bytes, count) == 0;
+}
+
+/**
+ * @brief Read a number of bytes
+ *
+ * @param count Number of bytes
+ * @return Pointer to the bytes inside the data
+ */
+const char* ByteReader::read(std::size_t count)
+{
+    if(count > this->remaining())
+    {
+        throw std::runtime_error("unexpected end of data");
+    }
+
+    const char* bytes = this->cursor;
+    this->cursor += count;
+    return bytes;
+}
+
+/**
+ * @brief Read an unsigned integer in the LEB128 encoding
+ *
+ * @return Value
+ */
+std::uint64_t ByteReader::readVarint()
+{
+    std::uint64_t value = 0;
+
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        if(this->cursor == this->end)
+        {
+            throw std::runtime_error("unexpected end of data");
+        }
+
+        unsigned char byte = static_cast<unsigned char>(*this->cursor++);
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+
+        if((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+
+    throw std::runtime_error("invalid varint");
+}
+
+/**
+ * @brief Parse the rest of a stream from memory. The rest of the stream is read with
+ * a single call, then the stream is positioned right after the parsed bytes if it
+ * supports positioning, so further data can follow
+ *
+ * @param is Input stream
+ * @param parse Function that parses the data
+ */
+void ByteReader::parseStream(std::istream& is, const std::function<void(ByteReader&)>& parse)
+{
+    std::istream::pos_type start = is.tellg();
+    std::vector<char> data;
+
+    // Streams that know their size are read with a single call
+    if(start != std::istream::pos_type(-1) && is.seekg(0, std::ios::end))
+    {
+        std::istream::pos_type stop = is.tellg();
+        is.seekg(start);
+        data.resize(static_cast<std::size_t>(stop - start));
+        is.read(data.data(), static_cast<std::streamsize>(data.size()));
+        data.resize(static_cast<std::size_t>(is.gcount()));
+    }
+    else
+    {
+        is.clear();
+        data.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    }
+
+    if(is.bad())
+    {
+        throw std::runtime_error("could not read data");
+    }
+
+    ByteReader reader(data.data(), data.size());
+    parse(reader);
+
+    if(start != std::istream::pos_type(-1))
+    {
+        is.clear();
+        is.seekg(start + static_cast<std::streamoff>(reader.position()));
+    }
+}
@@ -0,0 +1,127 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BYTE_READER_H_INCLUDED
+#define BYTE_READER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+
+/**
+ * @brief Class that parses serialized data from memory with a pointer cursor.
+ * Every read is checked against the end of the data and throws std::runtime_error
+ * if the data is truncated, so corrupt files are reported instead of being parsed
+ * into garbage
+ *
+ */
+class ByteReader
+{
+private:
+    /**
+     * @brief Start of the data
+     *
+     */
+    const char* begin;
+    /**
+     * @brief Current position
+     *
+     */
+    const char* cursor;
+    /**
+     * @brief End of the data
+     *
+     */
+    const char* end;
+
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param data Data to parse (must outlive the reader)
+     * @param size Size of the data in bytes
+     */
+    ByteReader(const char* data, std::size_t size);
+
+    /**
+     * @brief Get the number of bytes read so far
+     *
+     * @return Number of bytes read
+     */
+    std::size_t position() const;
+
+    /**
+     * @brief Get the number of bytes left
+     *
+     * @return Number of bytes left
+     */
+    std::size_t remaining() const;
+
+    /**
+     * @brief Check if the data at the current position starts with the given bytes
+     *
+     * @param bytes Bytes to compare
+     * @param count Number of bytes
+     * @return true if the next bytes are equal, false otherwise (or if there are fewer left)
+     */
+    bool startsWith(const char* bytes, std::size_t count) const;
+
+    /**
+     * @brief Read a number of bytes
+     *
+     * @param count Number of bytes
+     * @return Pointer to the bytes inside the data
+     */
+    const char* read(std::size_t count);
+
+    /**
+     * @brief Read a value of a trivially copyable type in the byte order of the host
+     *
+     * @tparam T Type of the value
+     * @return Value
+     */
+    template <typename T>
+    T readValue()
+    {
+        T value;
+        std::memcpy(&value, this->read(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief Read an unsigned integer in the LEB128 encoding
+     *
+     * @return Value
+     */
+    std::uint64_t readVarint();
+
+    /**
+     * @brief Parse the rest of a stream from memory. The rest of the stream is read with
+     * a single call, then the stream is positioned right after the parsed bytes if it
+     * supports positioning, so further data can follow
+     *
+     * @param is Input stream
+     * @param parse Function that parses the data
+     */
+    static void parseStream(std::istream& is, const std::function<void(ByteReader&)>& parse);
+};
+
+#endif // BYTE_READER_H_INCLUDED
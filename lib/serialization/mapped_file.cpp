@@ -0,0 +1,123 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "mapped_file.h"
+
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_USE_MMAP
+#endif
+
+/**
+ * @brief Map a file into memory
+ *
+ * @param filepath Path to the file
+ */
+MappedFile::MappedFile(const std::string& filepath) : contents(nullptr), length(0), buffer()
+{
+#ifdef MAPPED_FILE_USE_MMAP
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+
+    if(fd < 0)
+    {
+        throw std::runtime_error("could not open file " + filepath);
+    }
+
+    struct stat info;
+
+    if(::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("could not read file " + filepath);
+    }
+
+    this->length = static_cast<std::size_t>(info.st_size);
+
+    // Empty files can not be mapped
+    if(this->length > 0)
+    {
+        void* address = ::mmap(nullptr, this->length, PROT_READ, MAP_SHARED, fd, 0);
+
+        if(address == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("could not map file " + filepath);
+        }
+
+        this->contents = static_cast<const char*>(address);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+#else
+    std::ifstream file(filepath, std::ios::binary);
+
+    if(!file.is_open() || !file.good())
+    {
+        throw std::runtime_error("could not open file " + filepath);
+    }
+
+    this->buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    this->contents = this->buffer.data();
+    this->length = this->buffer.size();
+#endif
+}
+
+/**
+ * @brief Destructor. Unmaps the file
+ *
+ */
+MappedFile::~MappedFile()
+{
+#ifdef MAPPED_FILE_USE_MMAP
+    if(this->contents != nullptr)
+    {
+        ::munmap(const_cast<char*>(this->contents), this->length);
+    }
+#endif
+}
+
+/**
+ * @brief Get the contents of the file
+ *
+ * @return Pointer to the first byte of the file
+ */
+const char* MappedFile::data() const
+{
+    return this->contents;
+}
+
+/**
+ * @brief Get the size of the file
+ *
+ * @return Size of the file in bytes
+ */
+std::size_t MappedFile::size() const
+{
+    return this->length;
+}
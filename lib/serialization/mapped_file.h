@@ -0,0 +1,84 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAPPED_FILE_H_INCLUDED
+#define MAPPED_FILE_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Class that maps a file into memory for reading. The pages of the file are shared
+ * through the page cache, so several processes that map the same file use a single copy.
+ * On platforms without mmap the file is read into memory instead
+ *
+ */
+class MappedFile
+{
+private:
+    /**
+     * @brief Start of the mapped contents
+     *
+     */
+    const char* contents;
+    /**
+     * @brief Size of the file in bytes
+     *
+     */
+    std::size_t length;
+    /**
+     * @brief Contents of the file if it could not be mapped
+     *
+     */
+    std::vector<char> buffer;
+
+public:
+    /**
+     * @brief Map a file into memory
+     *
+     * @param filepath Path to the file
+     */
+    explicit MappedFile(const std::string& filepath);
+
+    /**
+     * @brief Destructor. Unmaps the file
+     *
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Get the contents of the file
+     *
+     * @return Pointer to the first byte of the file
+     */
+    const char* data() const;
+
+    /**
+     * @brief Get the size of the file
+     *
+     * @return Size of the file in bytes
+     */
+    std::size_t size() const;
+};
+
+#endif // MAPPED_FILE_H_INCLUDED
@@ -0,0 +1,38 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef VARINT_H_INCLUDED
+#define VARINT_H_INCLUDED
+
+#include <cstdint>
+#include <ostream>
+
+namespace Varint
+{
+    /**
+     * @brief Write an unsigned integer in the LEB128 encoding: 7 bits per byte,
+     * the least significant group first, the high bit of every byte but the last is set
+     *
+     * @param os Output stream
+     * @param value Value
+     */
+    void write(std::ostream& os, std::uint64_t value);
+}
+
+#endif // VARINT_H_INCLUDED
@@ -0,0 +1,636 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "dawg.h"
+#include "byte_reader.h"
+#include "varint.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Magic bytes at the start of a serialized DAWG
+ *
+ */
+static const char DAWG_MAGIC[4] = {'T', 'R', 'D', 'G'};
+
+/**
+ * @brief Version of the serialized DAWG format
+ *
+ */
+static const unsigned int DAWG_FORMAT_VERSION = 1;
+
+/**
+ * @brief Bit that marks the end of a word in the bitmap of a state
+ *
+ */
+static const std::uint32_t DAWG_END_OF_WORD = std::uint32_t(1) << 26;
+
+/**
+ * @brief Bits that mark the outgoing edges in the bitmap of a state
+ *
+ */
+static const std::uint32_t DAWG_EDGES = DAWG_END_OF_WORD - 1;
+
+/**
+ * @brief Get the bit of an edge in the bitmap of a state
+ *
+ * @param c English character (a-zA-Z)
+ * @return Bit of the edge, 0 if the character is not a letter
+ */
+static std::uint32_t edgeBit(char c)
+{
+    int lower = std::tolower(static_cast<unsigned char>(c));
+    unsigned int index = static_cast<unsigned int>(lower - 'a');
+    return (index < 26) ? (std::uint32_t(1) << index) : 0;
+}
+
+/**
+ * @brief Default constructor. Creates an empty DAWG
+ *
+ */
+Dawg::Dawg() : states(1, State{0, 0}), edges() {}
+
+/**
+ * @brief Build the DAWG from a list of words. The words are sorted, so equivalent
+ * suffixes can be merged while the words are added. Words with characters other
+ * than English letters are skipped
+ *
+ * @param words List of words
+ */
+void Dawg::build(std::vector<std::string> words)
+{
+    for(std::string& word : words)
+    {
+        std::transform(word.begin(), word.end(), word.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+    }
+
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    // States under construction. Edges of a state are added in the order of their
+    // characters, so the last edge always leads to the most recently added word
+    struct BuildState
+    {
+        std::uint32_t bitmap;
+        std::vector<std::uint32_t> targets;
+    };
+
+    std::vector<BuildState> build_states(1, BuildState{0, {}});
+
+    // States that are not yet compared with the registered ones (the path of the
+    // previous word below its common prefix with the next word)
+    std::vector<std::uint32_t> unchecked;
+
+    // Registered states by their bitmap and targets. Two states with the same bitmap
+    // and targets accept the same suffixes, so one of them is enough
+    std::unordered_map<std::string, std::uint32_t> registry;
+
+    // Replace the unchecked states deeper than the given depth by equivalent
+    // registered ones, or register them
+    auto minimize = [&](std::size_t depth)
+    {
+        while(unchecked.size() > depth)
+        {
+            std::uint32_t state = unchecked.back();
+            unchecked.pop_back();
+
+            const BuildState& current = build_states[state];
+            std::string key(reinterpret_cast<const char*>(&current.bitmap),
+                            sizeof(current.bitmap));
+            key.append(reinterpret_cast<const char*>(current.targets.data()),
+                       current.targets.size() * sizeof(std::uint32_t));
+
+            auto it = registry.emplace(std::move(key), state).first;
+            std::uint32_t parent = unchecked.empty() ? 0 : unchecked.back();
+            build_states[parent].targets.back() = it->second;
+        }
+    };
+
+    std::string previous;
+
+    for(const std::string& word : words)
+    {
+        bool valid = std::all_of(word.begin(), word.end(),
+                                 [](char c) { return edgeBit(c) != 0; });
+
+        if(!valid || word.empty())
+        {
+            continue;
+        }
+
+        // The prefix shared with the previous word is already in place
+        std::size_t common = 0;
+
+        while(common < previous.size() && common < word.size() &&
+              previous[common] == word[common])
+        {
+            common++;
+        }
+
+        minimize(common);
+
+        std::uint32_t state = unchecked.empty() ? 0 : unchecked.back();
+
+        for(std::size_t i = common; i < word.size(); i++)
+        {
+            std::uint32_t child = static_cast<std::uint32_t>(build_states.size());
+            build_states.push_back(BuildState{0, {}});
+            build_states[state].bitmap |= edgeBit(word[i]);
+            build_states[state].targets.push_back(child);
+            unchecked.push_back(child);
+            state = child;
+        }
+
+        build_states[state].bitmap |= DAWG_END_OF_WORD;
+        previous = word;
+    }
+
+    minimize(0);
+
+    // Number the reachable states in depth-first order, so a state usually follows
+    // the state it is reached from and a serialized state can be written in place
+    // of the first edge that leads to it
+    std::vector<std::uint32_t> index(build_states.size(), UINT32_MAX);
+    std::vector<std::uint32_t> order(1, 0);
+    std::vector<std::pair<std::uint32_t, std::size_t>> stack(1, {0, 0});
+    index[0] = 0;
+
+    while(!stack.empty())
+    {
+        std::pair<std::uint32_t, std::size_t>& top = stack.back();
+        const std::vector<std::uint32_t>& targets = build_states[top.first].targets;
+
+        if(top.second == targets.size())
+        {
+            stack.pop_back();
+            continue;
+        }
+
+        std::uint32_t target = targets[top.second++];
+
+        if(index[target] == UINT32_MAX)
+        {
+            index[target] = static_cast<std::uint32_t>(order.size());
+            order.push_back(target);
+            stack.push_back({target, 0});
+        }
+    }
+
+    this->states.clear();
+    this->edges.clear();
+
+    for(std::uint32_t state : order)
+    {
+        const BuildState& current = build_states[state];
+        this->states.push_back(State{current.bitmap,
+                                     static_cast<std::uint32_t>(this->edges.size())});
+
+        for(std::uint32_t target : current.targets)
+        {
+            this->edges.push_back(index[target]);
+        }
+    }
+}
+
+/**
+ * @brief Get the number of states
+ *
+ * @return Number of states
+ */
+std::size_t Dawg::stateCount() const
+{
+    return this->states.size();
+}
+
+/**
+ * @brief Get the number of edges
+ *
+ * @return Number of edges
+ */
+std::size_t Dawg::edgeCount() const
+{
+    return this->edges.size();
+}
+
+/**
+ * @brief Get the target of the edge of a state for the given character
+ *
+ * @param state Index of the state
+ * @param c English character (a-zA-Z)
+ * @return Index of the target state, -1 if there is no such edge
+ */
+std::int64_t Dawg::getChild(std::uint32_t state, char c) const
+{
+    std::uint32_t bit = edgeBit(c);
+    const State& current = this->states[state];
+
+    if((current.bitmap & bit) == 0)
+    {
+        return -1;
+    }
+
+    return this->edges[current.first_edge + __builtin_popcount(current.bitmap & (bit - 1))];
+}
+
+/**
+ * @brief Check if a state marks the end of a word
+ *
+ * @param state Index of the state
+ * @return true if the state is the end of a word, false otherwise
+ */
+bool Dawg::isEndOfWord(std::uint32_t state) const
+{
+    return (this->states[state].bitmap & DAWG_END_OF_WORD) != 0;
+}
+
+/**
+ * @brief Search a word in the DAWG
+ *
+ * @param word A word to search for
+ * @return true if a word exists in the DAWG, false otherwise
+ */
+bool Dawg::search(const std::string& word) const
+{
+    std::uint32_t state = 0;
+
+    for(char c : word)
+    {
+        std::int64_t child = this->getChild(state, c);
+
+        if(child < 0)
+        {
+            return false;
+        }
+
+        state = static_cast<std::uint32_t>(child);
+    }
+
+    return this->isEndOfWord(state);
+}
+
+/**
+ * @brief Check if the DAWG contains a word that starts with a given prefix
+ *
+ * @param prefix Prefix
+ * @return true if the DAWG contains a word that starts with a given prefix,
+ * false otherwise
+ */
+bool Dawg::startsWith(const std::string& prefix) const
+{
+    std::uint32_t state = 0;
+
+    for(char c : prefix)
+    {
+        std::int64_t child = this->getChild(state, c);
+
+        if(child < 0)
+        {
+            return false;
+        }
+
+        state = static_cast<std::uint32_t>(child);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Get a list of indices of all possible word endings (see Trie::getValidEndings)
+ *
+ * @param text Text that contains multiple words with spaces removed
+ * @param startPos Starting position (default is 0)
+ * @return A list of indices where a word might end
+ */
+std::vector<int> Dawg::getValidEndings(const std::string& text, int startPos) const
+{
+    std::vector<int> valid_endings;
+    std::uint32_t state = 0;
+
+    for(int i = startPos; i < static_cast<int>(text.length()); i++)
+    {
+        std::int64_t child = this->getChild(state, text[i]);
+
+        if(child < 0)
+        {
+            break;
+        }
+
+        state = static_cast<std::uint32_t>(child);
+
+        if(this->isEndOfWord(state))
+        {
+            valid_endings.push_back(i + 1);
+        }
+    }
+
+    return valid_endings;
+}
+
+/**
+ * @brief Check if any word in the DAWG matches the pattern. A wildcard ('*')
+ * matches any single character
+ *
+ * @param pattern Pattern to check
+ * @return true if any word in the DAWG matches the pattern, false otherwise
+ */
+bool Dawg::matchPattern(const std::string& pattern) const
+{
+    return this->matchPattern(pattern, 0, 0);
+}
+
+/**
+ * @brief Check if any word matches the pattern
+ *
+ * @param pattern Pattern to check
+ * @param index Starting index in the pattern
+ * @param state A state to start from
+ * @return true if any word matches the pattern, false otherwise
+ */
+bool Dawg::matchPattern(const std::string& pattern, std::size_t index, std::uint32_t state) const
+{
+    if(index == pattern.length()) // End of pattern
+    {
+        return this->isEndOfWord(state);
+    }
+
+    if(pattern[index] == '*') // wildcard
+    {
+        const State& current = this->states[state];
+        std::uint32_t end = current.first_edge + __builtin_popcount(current.bitmap & DAWG_EDGES);
+
+        for(std::uint32_t edge = current.first_edge; edge < end; edge++)
+        {
+            if(this->matchPattern(pattern, index + 1, this->edges[edge]))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::int64_t child = this->getChild(state, pattern[index]);
+    return child >= 0 && this->matchPattern(pattern, index + 1, static_cast<std::uint32_t>(child));
+}
+
+/**
+ * @brief Collect all words in the DAWG that match a given pattern. A wildcard ('*')
+ * matches any single character
+ *
+ * @param pattern Pattern that words should match
+ * @return A list of words that match a given pattern
+ */
+std::vector<std::string> Dawg::collectMatches(const std::string& pattern) const
+{
+    std::vector<std::string> results;
+    std::string current;
+    this->collectMatches(pattern, 0, 0, current, results);
+    return results;
+}
+
+/**
+ * @brief Collect all words that match a given pattern
+ *
+ * @param pattern Pattern that words should match
+ * @param index Starting index in the pattern
+ * @param state A state to start from
+ * @param current Part of a word that has been built
+ * @param results A list of words that match a given pattern
+ */
+void Dawg::collectMatches(const std::string& pattern, std::size_t index, std::uint32_t state,
+                          std::string& current, std::vector<std::string>& results) const
+{
+    if(index == pattern.length()) // End of pattern
+    {
+        if(this->isEndOfWord(state))
+        {
+            results.push_back(current);
+        }
+
+        return;
+    }
+
+    char ch = pattern[index];
+
+    if(ch == '*') // wildcard
+    {
+        const State& node = this->states[state];
+        std::uint32_t edge = node.first_edge;
+
+        // Edges follow in the order of their characters
+        for(char c = 'a'; c <= 'z'; c++)
+        {
+            if(node.bitmap & edgeBit(c))
+            {
+                current.push_back(c);
+                this->collectMatches(pattern, index + 1, this->edges[edge++], current, results);
+                current.pop_back();
+            }
+        }
+
+        return;
+    }
+
+    std::int64_t child = this->getChild(state, ch);
+
+    if(child >= 0)
+    {
+        current.push_back(ch);
+        this->collectMatches(pattern, index + 1, static_cast<std::uint32_t>(child), current,
+                             results);
+        current.pop_back();
+    }
+}
+
+/**
+ * @brief Serialize the DAWG. After the header follow the number of states and the states
+ * in depth-first order. A state is a LEB128 varint of its bitmap (as in a serialized
+ * Trie: the lowest bit marks the end of a word, the next 26 bits mark the edges from
+ * 'a' to 'z'), followed by a varint for every edge: 0 if the target state is written
+ * right after it, otherwise the number of the target state plus one
+ *
+ * @param os Output stream
+ */
+void Dawg::serialize(std::ostream& os) const
+{
+    // Write the header: magic bytes and the version of the format
+    unsigned int version = DAWG_FORMAT_VERSION;
+    os.write(DAWG_MAGIC, sizeof(DAWG_MAGIC));
+    os.write(reinterpret_cast<char*>(&version), sizeof(version));
+
+    Varint::write(os, this->states.size());
+
+    // States are numbered in depth-first order, so the target of an edge is written in
+    // place exactly when it is the next state to be written
+    std::uint32_t next = 0;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+
+    auto writeState = [&](std::uint32_t state)
+    {
+        const State& current = this->states[state];
+        std::uint32_t end_of_word = (current.bitmap & DAWG_END_OF_WORD) ? 1 : 0;
+        Varint::write(os, ((current.bitmap & DAWG_EDGES) << 1) | end_of_word);
+        stack.push_back({state, current.first_edge});
+        next++;
+    };
+
+    writeState(0);
+
+    while(!stack.empty())
+    {
+        std::pair<std::uint32_t, std::uint32_t>& top = stack.back();
+        const State& current = this->states[top.first];
+
+        if(top.second == current.first_edge + __builtin_popcount(current.bitmap & DAWG_EDGES))
+        {
+            stack.pop_back();
+            continue;
+        }
+
+        std::uint32_t target = this->edges[top.second++];
+
+        if(target == next)
+        {
+            Varint::write(os, 0);
+            writeState(target);
+        }
+        else
+        {
+            Varint::write(os, std::uint64_t(target) + 1);
+        }
+    }
+}
+
+/**
+ * @brief Deserialize the DAWG
+ *
+ * @param is Input stream
+ */
+void Dawg::deserialize(std::istream& is)
+{
+    ByteReader::parseStream(is, [this](ByteReader& reader) { this->deserialize(reader); });
+}
+
+/**
+ * @brief Deserialize the DAWG from memory
+ *
+ * @param reader Reader of the serialized data
+ */
+void Dawg::deserialize(ByteReader& reader)
+{
+    if(!reader.startsWith(DAWG_MAGIC, sizeof(DAWG_MAGIC)))
+    {
+        throw std::runtime_error("invalid DAWG data");
+    }
+
+    reader.read(sizeof(DAWG_MAGIC));
+    unsigned int version = reader.readValue<unsigned int>();
+
+    if(version > DAWG_FORMAT_VERSION)
+    {
+        throw std::runtime_error("unsupported DAWG format version " + std::to_string(version));
+    }
+
+    // Every state takes at least one byte
+    std::uint64_t state_count = reader.readVarint();
+
+    if(state_count == 0 || state_count > reader.remaining())
+    {
+        throw std::runtime_error("invalid DAWG data");
+    }
+
+    // The states are read aside, so a corrupt file leaves the DAWG unchanged
+    std::vector<State> states;
+    std::vector<std::uint32_t> edges;
+    states.reserve(static_cast<std::size_t>(state_count));
+
+    // Edges lead only to states that are completely read, so the graph stays acyclic
+    std::vector<bool> complete;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+
+    auto readState = [&]()
+    {
+        std::uint64_t bitmap = reader.readVarint();
+
+        if(bitmap >> 27 != 0 || states.size() == state_count)
+        {
+            throw std::runtime_error("invalid DAWG data");
+        }
+
+        std::uint32_t edge_bits = static_cast<std::uint32_t>(bitmap >> 1);
+        std::uint32_t end_of_word = (bitmap & 1) ? DAWG_END_OF_WORD : 0;
+        std::uint32_t first_edge = static_cast<std::uint32_t>(edges.size());
+
+        stack.push_back({static_cast<std::uint32_t>(states.size()), first_edge});
+        states.push_back(State{edge_bits | end_of_word, first_edge});
+        complete.push_back(false);
+        edges.resize(edges.size() + __builtin_popcount(edge_bits));
+    };
+
+    readState();
+
+    while(!stack.empty())
+    {
+        std::pair<std::uint32_t, std::uint32_t>& top = stack.back();
+        const State& current = states[top.first];
+
+        if(top.second == current.first_edge + __builtin_popcount(current.bitmap & DAWG_EDGES))
+        {
+            complete[top.first] = true;
+            stack.pop_back();
+            continue;
+        }
+
+        std::uint32_t edge = top.second++;
+        std::uint64_t reference = reader.readVarint();
+
+        if(reference == 0)
+        {
+            edges[edge] = static_cast<std::uint32_t>(states.size());
+            readState();
+        }
+        else if(reference <= states.size() && complete[reference - 1])
+        {
+            edges[edge] = static_cast<std::uint32_t>(reference - 1);
+        }
+        else
+        {
+            throw std::runtime_error("invalid DAWG data");
+        }
+    }
+
+    if(states.size() != state_count)
+    {
+        throw std::runtime_error("invalid DAWG data");
+    }
+
+    this->states = std::move(states);
+    this->edges = std::move(edges);
+}
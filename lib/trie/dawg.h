@@ -0,0 +1,208 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DAWG_H_INCLUDED
+#define DAWG_H_INCLUDED
+
+#include "byte_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Class that represents a minimized DAWG (directed acyclic word graph). It holds
+ * the same words as a Trie and answers the same queries, but equivalent suffixes are
+ * stored only once, so it takes a fraction of the memory of a Trie
+ *
+ */
+class Dawg
+{
+private:
+    /**
+     * @brief State of the DAWG
+     *
+     */
+    struct State
+    {
+        /**
+         * @brief Bits 0-25 mark the outgoing edges for characters a-z,
+         * bit 26 marks the end of a word
+         *
+         */
+        std::uint32_t bitmap;
+        /**
+         * @brief Index of the first outgoing edge, the edges of a state are stored
+         * next to each other in the order of their characters
+         *
+         */
+        std::uint32_t first_edge;
+    };
+
+    /**
+     * @brief States of the DAWG, the first one is the root
+     *
+     */
+    std::vector<State> states;
+    /**
+     * @brief Target states of all edges
+     *
+     */
+    std::vector<std::uint32_t> edges;
+
+public:
+    /**
+     * @brief Default constructor. Creates an empty DAWG
+     *
+     */
+    Dawg();
+
+    /**
+     * @brief Build the DAWG from a list of words. The words are sorted, so equivalent
+     * suffixes can be merged while the words are added. Words with characters other
+     * than English letters are skipped
+     *
+     * @param words List of words
+     */
+    void build(std::vector<std::string> words);
+
+    /**
+     * @brief Get the number of states
+     *
+     * @return Number of states
+     */
+    std::size_t stateCount() const;
+
+    /**
+     * @brief Get the number of edges
+     *
+     * @return Number of edges
+     */
+    std::size_t edgeCount() const;
+
+    /**
+     * @brief Search a word in the DAWG
+     *
+     * @param word A word to search for
+     * @return true if a word exists in the DAWG, false otherwise
+     */
+    bool search(const std::string& word) const;
+
+    /**
+     * @brief Check if the DAWG contains a word that starts with a given prefix
+     *
+     * @param prefix Prefix
+     * @return true if the DAWG contains a word that starts with a given prefix,
+     * false otherwise
+     */
+    bool startsWith(const std::string& prefix) const;
+
+    /**
+     * @brief Get a list of indices of all possible word endings (see Trie::getValidEndings)
+     *
+     * @param text Text that contains multiple words with spaces removed
+     * @param startPos Starting position (default is 0)
+     * @return A list of indices where a word might end
+     */
+    std::vector<int> getValidEndings(const std::string& text, int startPos = 0) const;
+
+    /**
+     * @brief Check if any word in the DAWG matches the pattern. A wildcard ('*')
+     * matches any single character
+     *
+     * @param pattern Pattern to check
+     * @return true if any word in the DAWG matches the pattern, false otherwise
+     */
+    bool matchPattern(const std::string& pattern) const;
+
+    /**
+     * @brief Collect all words in the DAWG that match a given pattern. A wildcard ('*')
+     * matches any single character
+     *
+     * @param pattern Pattern that words should match
+     * @return A list of words that match a given pattern
+     */
+    std::vector<std::string> collectMatches(const std::string& pattern) const;
+
+    /**
+     * @brief Serialize the DAWG
+     *
+     * @param os Output stream
+     */
+    void serialize(std::ostream& os) const;
+
+    /**
+     * @brief Deserialize the DAWG
+     *
+     * @param is Input stream
+     */
+    void deserialize(std::istream& is);
+
+    /**
+     * @brief Deserialize the DAWG from memory
+     *
+     * @param reader Reader of the serialized data
+     */
+    void deserialize(ByteReader& reader);
+
+private:
+    /**
+     * @brief Get the target of the edge of a state for the given character
+     *
+     * @param state Index of the state
+     * @param c English character (a-zA-Z)
+     * @return Index of the target state, -1 if there is no such edge
+     */
+    std::int64_t getChild(std::uint32_t state, char c) const;
+
+    /**
+     * @brief Check if a state marks the end of a word
+     *
+     * @param state Index of the state
+     * @return true if the state is the end of a word, false otherwise
+     */
+    bool isEndOfWord(std::uint32_t state) const;
+
+    /**
+     * @brief Check if any word matches the pattern
+     *
+     * @param pattern Pattern to check
+     * @param index Starting index in the pattern
+     * @param state A state to start from
+     * @return true if any word matches the pattern, false otherwise
+     */
+    bool matchPattern(const std::string& pattern, std::size_t index, std::uint32_t state) const;
+
+    /**
+     * @brief Collect all words that match a given pattern
+     *
+     * @param pattern Pattern that words should match
+     * @param index Starting index in the pattern
+     * @param state A state to start from
+     * @param current Part of a word that has been built
+     * @param results A list of words that match a given pattern
+     */
+    void collectMatches(const std::string& pattern, std::size_t index, std::uint32_t state,
+                        std::string& current, std::vector<std::string>& results) const;
+};
+
+#endif // DAWG_H_INCLUDED
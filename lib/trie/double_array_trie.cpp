@@ -0,0 +1,487 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "double_array_trie.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Magic bytes at the start of a double-array trie file
+ *
+ */
+static const char DOUBLE_ARRAY_TRIE_MAGIC[8] = {'T', 'R', 'D', 'A', 'T', 'R', 'I', 'E'};
+/**
+ * @brief Version of the double-array trie format
+ *
+ */
+static const std::uint32_t DOUBLE_ARRAY_TRIE_VERSION = 1;
+/**
+ * @brief Size of the file header in bytes
+ *
+ */
+static const std::size_t DOUBLE_ARRAY_TRIE_HEADER_SIZE = sizeof(DOUBLE_ARRAY_TRIE_MAGIC) + 2 * 4;
+/**
+ * @brief Check of a free unit, also returned for a missing transition
+ *
+ */
+static const std::uint32_t DOUBLE_ARRAY_TRIE_EMPTY = 0xFFFFFFFF;
+/**
+ * @brief Bit of the base that marks the end of a word
+ *
+ */
+static const std::uint32_t DOUBLE_ARRAY_TRIE_END_OF_WORD = 0x80000000;
+/**
+ * @brief Number of units added at once when the free units run out during a build
+ *
+ */
+static const std::uint32_t DOUBLE_ARRAY_TRIE_GROWTH = 1024;
+
+// Units are stored in the file exactly as they are laid out in memory
+static_assert(sizeof(DoubleArrayTrie::Unit) == 2 * 4,
+              "unexpected padding in DoubleArrayTrie::Unit");
+
+/**
+ * @brief Check if the host stores integers in little-endian byte order
+ *
+ * @return true if the host is little-endian, false otherwise
+ */
+static bool isLittleEndian()
+{
+    const std::uint32_t value = 1;
+    unsigned char first;
+    std::memcpy(&first, &value, 1);
+    return first == 1;
+}
+
+/**
+ * @brief Write a 32-bit integer in little-endian byte order
+ *
+ * @param os Output stream
+ * @param value Value to write
+ */
+static void writeUint32(std::ostream& os, std::uint32_t value)
+{
+    char bytes[4];
+
+    for(int i = 0; i < 4; i++)
+    {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+
+    os.write(bytes, sizeof(bytes));
+}
+
+/**
+ * @brief Read a 32-bit integer stored in little-endian byte order
+ *
+ * @param data Pointer to the first byte of the integer
+ * @return Value of the integer
+ */
+static std::uint32_t readUint32(const char* data)
+{
+    std::uint32_t value = 0;
+
+    for(int i = 0; i < 4; i++)
+    {
+        value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+
+    return value;
+}
+
+/**
+ * @brief Get the code of a character. Both cases of a letter have the same code
+ *
+ * @param c Character
+ * @return Code of the character (1-26 for a-z), 0 if it is not an English letter
+ */
+static std::uint32_t letterCode(char c)
+{
+    // Setting bit 5 turns an ASCII uppercase letter into the lowercase one
+    std::uint32_t index = (static_cast<unsigned char>(c) | 0x20u) - 'a';
+    return (index < 26) ? index + 1 : 0;
+}
+
+/**
+ * @brief Default constructor. Creates an empty trie
+ *
+ */
+DoubleArrayTrie::DoubleArrayTrie() :
+    unit_storage(1, Unit{0, DOUBLE_ARRAY_TRIE_EMPTY}),
+    file(nullptr),
+    units(nullptr),
+    unit_count(1)
+{
+    this->units = this->unit_storage.data();
+}
+
+/**
+ * @brief Build the trie from a list of words. Words with characters other
+ * than English letters are skipped
+ *
+ * @param words List of words
+ */
+void DoubleArrayTrie::build(std::vector<std::string> words)
+{
+    words.erase(std::remove_if(words.begin(), words.end(),
+                               [](const std::string& word)
+                               {
+                                   return std::any_of(word.begin(), word.end(),
+                                                      [](char c) { return letterCode(c) == 0; });
+                               }),
+                words.end());
+
+    for(std::string& word : words)
+    {
+        std::transform(word.begin(), word.end(), word.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+    }
+
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    // Free units are linked in the order of their indices, so the search for a base
+    // fills the array from the start. The root is never free
+    std::vector<Unit> built(1, Unit{0, DOUBLE_ARRAY_TRIE_EMPTY});
+    std::vector<std::uint32_t> next_free(1, DOUBLE_ARRAY_TRIE_EMPTY);
+    std::vector<std::uint32_t> prev_free(1, DOUBLE_ARRAY_TRIE_EMPTY);
+    std::uint32_t first_free = DOUBLE_ARRAY_TRIE_EMPTY;
+    std::uint32_t last_free = DOUBLE_ARRAY_TRIE_EMPTY;
+
+    auto extend = [&](std::size_t size)
+    {
+        for(std::size_t i = built.size(); i < size; i++)
+        {
+            std::uint32_t unit = static_cast<std::uint32_t>(i);
+            built.push_back(Unit{0, DOUBLE_ARRAY_TRIE_EMPTY});
+            next_free.push_back(DOUBLE_ARRAY_TRIE_EMPTY);
+            prev_free.push_back(last_free);
+
+            if(last_free == DOUBLE_ARRAY_TRIE_EMPTY)
+            {
+                first_free = unit;
+            }
+            else
+            {
+                next_free[last_free] = unit;
+            }
+
+            last_free = unit;
+        }
+    };
+
+    auto occupy = [&](std::uint32_t unit, std::uint32_t parent)
+    {
+        std::uint32_t prev = prev_free[unit];
+        std::uint32_t next = next_free[unit];
+        (prev == DOUBLE_ARRAY_TRIE_EMPTY ? first_free : next_free[prev]) = next;
+        (next == DOUBLE_ARRAY_TRIE_EMPTY ? last_free : prev_free[next]) = prev;
+        built[unit].check = parent;
+    };
+
+    // Find the smallest base at which all codes of the transitions land on free units
+    auto findBase = [&](const std::vector<std::uint32_t>& codes) -> std::uint32_t
+    {
+        std::uint32_t unit = first_free;
+
+        while(true)
+        {
+            if(unit == DOUBLE_ARRAY_TRIE_EMPTY)
+            {
+                unit = static_cast<std::uint32_t>(built.size());
+                extend(built.size() + DOUBLE_ARRAY_TRIE_GROWTH);
+            }
+
+            if(unit >= codes.front())
+            {
+                std::uint32_t base = unit - codes.front();
+                extend(std::max<std::size_t>(built.size(), base + codes.back() + 1));
+
+                bool fits = std::all_of(codes.begin(), codes.end(),
+                                        [&](std::uint32_t code)
+                                        {
+                                            return built[base + code].check ==
+                                                   DOUBLE_ARRAY_TRIE_EMPTY;
+                                        });
+
+                if(fits)
+                {
+                    return base;
+                }
+            }
+
+            unit = next_free[unit];
+        }
+    };
+
+    // States are placed in breadth-first order. Every state covers the range of
+    // sorted words that share its prefix
+    struct Pending
+    {
+        std::uint32_t state;
+        std::size_t begin;
+        std::size_t end;
+        std::size_t depth;
+    };
+
+    std::vector<Pending> queue;
+    queue.push_back(Pending{0, 0, words.size(), 0});
+    std::vector<std::uint32_t> codes;
+    std::vector<std::size_t> starts;
+
+    for(std::size_t i = 0; i < queue.size(); i++)
+    {
+        Pending pending = queue[i];
+        std::size_t begin = pending.begin;
+        std::uint32_t end_of_word = 0;
+
+        // The word equal to the prefix comes first
+        if(begin < pending.end && words[begin].size() == pending.depth)
+        {
+            end_of_word = DOUBLE_ARRAY_TRIE_END_OF_WORD;
+            begin++;
+        }
+
+        codes.clear();
+        starts.clear();
+
+        for(std::size_t j = begin; j < pending.end; j++)
+        {
+            std::uint32_t code = letterCode(words[j][pending.depth]);
+
+            if(codes.empty() || codes.back() != code)
+            {
+                codes.push_back(code);
+                starts.push_back(j);
+            }
+        }
+
+        starts.push_back(pending.end);
+
+        std::uint32_t base = codes.empty() ? 0 : findBase(codes);
+        built[pending.state].base = base | end_of_word;
+
+        for(std::size_t j = 0; j < codes.size(); j++)
+        {
+            std::uint32_t child = base + codes[j];
+            occupy(child, pending.state);
+            queue.push_back(Pending{child, starts[j], starts[j + 1], pending.depth + 1});
+        }
+    }
+
+    // Free units at the end are never reached
+    while(built.size() > 1 && built.back().check == DOUBLE_ARRAY_TRIE_EMPTY)
+    {
+        built.pop_back();
+    }
+
+    if(built.size() > DOUBLE_ARRAY_TRIE_END_OF_WORD)
+    {
+        throw std::runtime_error("too many words for a double-array trie");
+    }
+
+    this->file.reset();
+    this->unit_storage = std::move(built);
+    this->units = this->unit_storage.data();
+    this->unit_count = static_cast<std::uint32_t>(this->unit_storage.size());
+}
+
+/**
+ * @brief Get the number of units, including the free ones
+ *
+ * @return Number of units
+ */
+std::size_t DoubleArrayTrie::size() const
+{
+    return this->unit_count;
+}
+
+/**
+ * @brief Follow the transition of a state by a character
+ *
+ * @param state Index of the state
+ * @param c English character (a-zA-Z)
+ * @return Index of the next state, all bits set if there is no transition
+ */
+std::uint32_t DoubleArrayTrie::next(std::uint32_t state, char c) const
+{
+    std::uint32_t code = letterCode(c);
+    std::uint32_t target = (this->units[state].base & ~DOUBLE_ARRAY_TRIE_END_OF_WORD) + code;
+
+    if(code == 0 || target >= this->unit_count || this->units[target].check != state)
+    {
+        return DOUBLE_ARRAY_TRIE_EMPTY;
+    }
+
+    return target;
+}
+
+/**
+ * @brief Follow the transitions of a state by the characters of a string
+ *
+ * @param s String
+ * @return Index of the reached state, all bits set if there is no path
+ */
+std::uint32_t DoubleArrayTrie::walk(const std::string& s) const
+{
+    std::uint32_t state = 0;
+
+    for(char c : s)
+    {
+        state = this->next(state, c);
+
+        if(state == DOUBLE_ARRAY_TRIE_EMPTY)
+        {
+            break;
+        }
+    }
+
+    return state;
+}
+
+/**
+ * @brief Search a word in the trie
+ *
+ * @param word A word to search for
+ * @return true if a word exists in the trie, false otherwise
+ */
+bool DoubleArrayTrie::search(const std::string& word) const
+{
+    std::uint32_t state = this->walk(word);
+    return state != DOUBLE_ARRAY_TRIE_EMPTY &&
+           (this->units[state].base & DOUBLE_ARRAY_TRIE_END_OF_WORD) != 0;
+}
+
+/**
+ * @brief Check if the trie contains a word that starts with a given prefix
+ *
+ * @param prefix Prefix
+ * @return true if the trie contains a word that starts with a given prefix,
+ * false otherwise
+ */
+bool DoubleArrayTrie::startsWith(const std::string& prefix) const
+{
+    return this->walk(prefix) != DOUBLE_ARRAY_TRIE_EMPTY;
+}
+
+/**
+ * @brief Get a list of indices of all possible word endings (see Trie::getValidEndings)
+ *
+ * @param text Text that contains multiple words with spaces removed
+ * @param startPos Starting position (default is 0)
+ * @return A list of indices where a word might end
+ */
+std::vector<int> DoubleArrayTrie::getValidEndings(const std::string& text, int startPos) const
+{
+    std::vector<int> valid_endings;
+    std::uint32_t state = 0;
+
+    for(int i = startPos; i < static_cast<int>(text.length()); i++)
+    {
+        state = this->next(state, text[i]);
+
+        if(state == DOUBLE_ARRAY_TRIE_EMPTY)
+        {
+            break;
+        }
+
+        if(this->units[state].base & DOUBLE_ARRAY_TRIE_END_OF_WORD)
+        {
+            valid_endings.push_back(i + 1);
+        }
+    }
+
+    return valid_endings;
+}
+
+/**
+ * @brief Write the trie in the memory-mappable format
+ *
+ * @param os Output stream
+ */
+void DoubleArrayTrie::serialize(std::ostream& os) const
+{
+    os.write(DOUBLE_ARRAY_TRIE_MAGIC, sizeof(DOUBLE_ARRAY_TRIE_MAGIC));
+    writeUint32(os, DOUBLE_ARRAY_TRIE_VERSION);
+    writeUint32(os, this->unit_count);
+
+    for(std::uint32_t i = 0; i < this->unit_count; i++)
+    {
+        writeUint32(os, this->units[i].base);
+        writeUint32(os, this->units[i].check);
+    }
+}
+
+/**
+ * @brief Map a file written by serialize() into memory. The trie is queried
+ * in place, without reading the units
+ *
+ * @param filepath Path to the file
+ */
+void DoubleArrayTrie::map(const std::string& filepath)
+{
+    // Units are used in place, so their byte order must match the host
+    if(!isLittleEndian())
+    {
+        throw std::runtime_error("memory-mapped double-array trie requires a little-endian host");
+    }
+
+    std::unique_ptr<MappedFile> mapped = std::make_unique<MappedFile>(filepath);
+    const char* data = mapped->data();
+    std::size_t size = mapped->size();
+
+    if(size < DOUBLE_ARRAY_TRIE_HEADER_SIZE ||
+       std::memcmp(data, DOUBLE_ARRAY_TRIE_MAGIC, sizeof(DOUBLE_ARRAY_TRIE_MAGIC)) != 0)
+    {
+        throw std::runtime_error("invalid double-array trie file " + filepath);
+    }
+
+    const char* header = data + sizeof(DOUBLE_ARRAY_TRIE_MAGIC);
+
+    if(readUint32(header) != DOUBLE_ARRAY_TRIE_VERSION)
+    {
+        throw std::runtime_error("unsupported double-array trie file version in " + filepath);
+    }
+
+    // Transitions are checked against the number of units, so any unit contents are safe
+    std::uint32_t unit_count = readUint32(header + 4);
+
+    if(unit_count == 0 ||
+       DOUBLE_ARRAY_TRIE_HEADER_SIZE + std::size_t(unit_count) * sizeof(Unit) != size)
+    {
+        throw std::runtime_error("invalid double-array trie file " + filepath);
+    }
+
+    this->unit_storage.clear();
+
+    this->file = std::move(mapped);
+    this->units = reinterpret_cast<const Unit*>(data + DOUBLE_ARRAY_TRIE_HEADER_SIZE);
+    this->unit_count = unit_count;
+}
@@ -0,0 +1,174 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DOUBLE_ARRAY_TRIE_H_INCLUDED
+#define DOUBLE_ARRAY_TRIE_H_INCLUDED
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Class that represents a frozen (read-only) Trie stored as a double array.
+ * The transition of state s by a character with code c (1-26 for a-z) leads to state
+ * t = base[s] + c if check[t] == s, so every character of a lookup takes two array reads.
+ * The base and check of a state are stored next to each other in a unit, together with
+ * the end-of-word flag, which is read with the check of the state it leads to.
+ *
+ * The units are either owned by the trie or point into a memory-mapped file, which
+ * is queried in place. The file starts with a header (8-byte magic, then the format
+ * version and the number of units as 32-bit integers), followed by the units.
+ * All integers are little-endian
+ *
+ */
+class DoubleArrayTrie
+{
+public:
+    /**
+     * @brief A state of the trie
+     *
+     */
+    struct Unit
+    {
+        /**
+         * @brief Offset of the transitions of the state (bits 0-30), bit 31 marks
+         * the end of a word
+         *
+         */
+        std::uint32_t base;
+        /**
+         * @brief State that leads to this one (all bits set if the unit is free)
+         *
+         */
+        std::uint32_t check;
+    };
+
+private:
+    /**
+     * @brief Storage for the units if the trie is not memory-mapped
+     *
+     */
+    std::vector<Unit> unit_storage;
+    /**
+     * @brief Memory-mapped file (nullptr if the trie is not memory-mapped)
+     *
+     */
+    std::unique_ptr<MappedFile> file;
+    /**
+     * @brief Units of all states (the root is the first unit)
+     *
+     */
+    const Unit* units;
+    /**
+     * @brief Number of units
+     *
+     */
+    std::uint32_t unit_count;
+
+public:
+    /**
+     * @brief Default constructor. Creates an empty trie
+     *
+     */
+    DoubleArrayTrie();
+
+    DoubleArrayTrie(const DoubleArrayTrie&) = delete;
+    DoubleArrayTrie& operator=(const DoubleArrayTrie&) = delete;
+
+    /**
+     * @brief Build the trie from a list of words. Words with characters other
+     * than English letters are skipped
+     *
+     * @param words List of words
+     */
+    void build(std::vector<std::string> words);
+
+    /**
+     * @brief Get the number of units, including the free ones
+     *
+     * @return Number of units
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Search a word in the trie
+     *
+     * @param word A word to search for
+     * @return true if a word exists in the trie, false otherwise
+     */
+    bool search(const std::string& word) const;
+
+    /**
+     * @brief Check if the trie contains a word that starts with a given prefix
+     *
+     * @param prefix Prefix
+     * @return true if the trie contains a word that starts with a given prefix,
+     * false otherwise
+     */
+    bool startsWith(const std::string& prefix) const;
+
+    /**
+     * @brief Get a list of indices of all possible word endings (see Trie::getValidEndings)
+     *
+     * @param text Text that contains multiple words with spaces removed
+     * @param startPos Starting position (default is 0)
+     * @return A list of indices where a word might end
+     */
+    std::vector<int> getValidEndings(const std::string& text, int startPos = 0) const;
+
+    /**
+     * @brief Write the trie in the memory-mappable format
+     *
+     * @param os Output stream
+     */
+    void serialize(std::ostream& os) const;
+
+    /**
+     * @brief Map a file written by serialize() into memory. The trie is queried
+     * in place, without reading the units
+     *
+     * @param filepath Path to the file
+     */
+    void map(const std::string& filepath);
+
+private:
+    /**
+     * @brief Follow the transition of a state by a character
+     *
+     * @param state Index of the state
+     * @param c English character (a-zA-Z)
+     * @return Index of the next state, all bits set if there is no transition
+     */
+    std::uint32_t next(std::uint32_t state, char c) const;
+
+    /**
+     * @brief Follow the transitions of a state by the characters of a string
+     *
+     * @param s String
+     * @return Index of the reached state, all bits set if there is no path
+     */
+    std::uint32_t walk(const std::string& s) const;
+};
+
+#endif // DOUBLE_ARRAY_TRIE_H_INCLUDED
@@ -18,13 +18,66 @@
 */
 
 #include "trie.h"
+#include "byte_reader.h"
 #include "trie_node.h"
+#include "varint.h"
 
+#include <algorithm>
 #include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+/**
+ * @brief Magic bytes at the start of a serialized Trie with a header
+ *
+ */
+static const char TRIE_MAGIC[4] = {'T', 'R', 'I', 'E'};
+/**
+ * @brief Version of the serialized Trie format. Version 0 is the original format without
+ * a header, version 1 stores every node as a varint bitmap of its children
+ *
+ */
+static const unsigned int TRIE_FORMAT_VERSION = 1;
+
+/**
+ * @brief Check if a word below a node can end after the given number of characters
+ *
+ * @param node A Trie node
+ * @param remaining Number of characters
+ * @return true if the number is within the remaining depths of the node, false otherwise
+ */
+static bool fitsDepth(const TrieNode* node, std::size_t remaining)
+{
+    return remaining >= node->getMinDepth() && remaining <= node->getMaxDepth();
+}
+
+/**
+ * @brief Compute the remaining depths of a node whose children are complete
+ *
+ * @param node A Trie node
+ */
+static void includeSubtreeDepths(TrieNode* node)
+{
+    if(node->isEndOfWord())
+    {
+        node->includeDepth(0);
+    }
+
+    for(std::uint32_t mask = node->getChildMask(); mask != 0; mask &= mask - 1)
+    {
+        node->includeChildDepths(*node->getChild(static_cast<char>('a' + __builtin_ctz(mask))));
+    }
+}
+
 /**
  * @brief Default constructor
  *
@@ -39,17 +92,21 @@ Trie::Trie() : root(std::make_unique<TrieNode>()) {}
 void Trie::insert(const std::string& word)
 {
     TrieNode* node = this->root.get();
+    unsigned int remaining = static_cast<unsigned int>(word.length());
 
     for(char c : word)
     {
         if(!node->hasChild(c))
         {
-            node->createChild(c);
+            node->createChild(c, this->pool);
         }
 
+        // Every node on the path is above the end of the word
+        node->includeDepth(remaining--);
         node = node->getChild(c);
     }
 
+    node->includeDepth(0);
     node->setEndOfWord(true);
 }
 
@@ -155,6 +212,12 @@ bool Trie::matchPattern(const std::string& pattern) const
  */
 bool Trie::matchPattern(const std::string& pattern, int index, TrieNode* node) const
 {
+    // Skip the subtree if no word below ends where the pattern ends
+    if(!fitsDepth(node, pattern.length() - index))
+    {
+        return false;
+    }
+
     if(index == pattern.length()) // End of pattern
     {
         // Match only if this is a word
@@ -224,50 +287,220 @@ std::vector<std::string> Trie::collectMatches(const std::string& pattern) const
 void Trie::collectMatches(const std::string& pattern, int index, TrieNode* node,
                           const std::string& current, std::vector<std::string>& results) const
 {
-    if(index == pattern.length()) // End of pattern
+    std::string buffer = current;
+    this->collectMatches(pattern, index, node, buffer,
+                         [&results](std::string_view word)
+                         {
+                             results.emplace_back(word);
+                             return true;
+                         });
+}
+
+/**
+ * @brief Visit all words in Trie that match a given pattern, in alphabetical order.
+ * The words are built in a single buffer, so no strings are allocated
+ *
+ * @param pattern Pattern that words should match
+ * @param visitor Function that receives every matching word (valid only during the call)
+ * and returns false to stop the traversal
+ * @return false if the visitor stopped the traversal, true otherwise
+ */
+bool Trie::collectMatches(const std::string& pattern,
+                          const std::function<bool(std::string_view)>& visitor) const
+{
+    std::string buffer;
+    buffer.reserve(pattern.length());
+    return this->collectMatches(pattern, 0, this->root.get(), buffer, visitor);
+}
+
+/**
+ * @brief Visit all words in Trie that match a given pattern, in alphabetical order
+ *
+ * @param pattern Pattern that words should match
+ * @param index Starting index in the pattern
+ * @param node A Trie node to start from
+ * @param buffer Part of a word that has been built, restored before returning
+ * @param visitor Function that receives every matching word (valid only during the call)
+ * and returns false to stop the traversal
+ * @return false if the visitor stopped the traversal, true otherwise
+ */
+bool Trie::collectMatches(const std::string& pattern, int index, TrieNode* node,
+                          std::string& buffer,
+                          const std::function<bool(std::string_view)>& visitor) const
+{
+    // Skip the subtree if no word below ends where the pattern ends
+    if(!fitsDepth(node, pattern.length() - index))
     {
-        // If this is the end of the word, add it to the list
-        if(node->isEndOfWord())
-        {
-            results.push_back(current);
-        }
+        return true;
+    }
 
-        return;
+    if(index == pattern.length()) // End of pattern
+    {
+        // If this is the end of the word, pass it to the visitor
+        return !node->isEndOfWord() || visitor(buffer);
     }
 
     char ch = pattern[index];
 
     if(ch == '*') // wildcard
     {
-        // Try all possible characters
-        for(char c = 'a'; c <= 'z'; c++)
+        // Try the characters of all existing children
+        for(std::uint32_t mask = node->getChildMask(); mask != 0; mask &= mask - 1)
         {
-            if(!node->hasChild(c))
+            char c = static_cast<char>('a' + __builtin_ctz(mask));
+
+            buffer.push_back(c);
+            bool proceed = this->collectMatches(pattern, index + 1, node->getChild(c), buffer,
+                                                visitor);
+            buffer.pop_back();
+
+            if(!proceed)
             {
-                continue;
+                return false;
             }
-
-            this->collectMatches(pattern, index + 1, node->getChild(c), current + c, results);
         }
+
+        return true;
     }
-    else
+
+    // Safety check: check if a character is a letter in the English alphabet
+    // Cast to unsigned char in order for it to work correctly
+    if(!std::isalpha(static_cast<unsigned char>(ch)) || !node->hasChild(ch))
     {
-        // Safety check: check if a character is a letter in the English alphabet
-        // Cast to unsigned char in order for it to work correctly
-        if(!std::isalpha(static_cast<unsigned char>(ch)))
+        return true;
+    }
+
+    buffer.push_back(ch);
+    bool proceed = this->collectMatches(pattern, index + 1, node->getChild(ch), buffer, visitor);
+    buffer.pop_back();
+    return proceed;
+}
+
+/**
+ * @brief Find all words in the Trie within the tolerance value of the query.
+ * The Damerau–Levenshtein edit distance matrix is computed one row per Trie node,
+ * so words sharing a prefix share its rows. A wildcard ('*') in the query
+ * matches any single character
+ *
+ * @param query Query
+ * @param tolerance Tolerance value (max edit distance)
+ * @return Pairs of edit distance and word, in alphabetical order of words
+ */
+std::vector<std::pair<int, std::string>> Trie::fuzzyFind(const std::string& query,
+                                                         unsigned int tolerance) const
+{
+    std::vector<std::pair<int, std::string>> results;
+
+    // Same layout as the matrix of EditDistance::editDistanceMatrix with the words of the
+    // Trie as rows: row i + 1 is the distance between the first i characters of a word
+    // and every prefix of the query. Row 0 and column 0 hold a value larger than any distance
+    const std::size_t columns = query.length() + 2;
+    const int maxdist = std::numeric_limits<int>::max() / 2;
+    std::vector<int> matrix(2 * columns, maxdist);
+
+    for(std::size_t j = 1; j < columns; j++)
+    {
+        matrix[columns + j] = static_cast<int>(j - 1);
+    }
+
+    std::size_t last_row[26] = {};
+    std::string current;
+
+    this->fuzzyFind(query, static_cast<int>(tolerance), this->root.get(), current, matrix,
+                    last_row, results);
+
+    return results;
+}
+
+/**
+ * @brief Find all words within the tolerance value of the query below a given node.
+ * The branch is skipped if no cell of the node's row is within the tolerance,
+ * as the rows of longer words can not get smaller
+ *
+ * @param query Query
+ * @param tolerance Tolerance value (max edit distance)
+ * @param node A Trie node to start from
+ * @param current Part of a word that has been built (the word of the node)
+ * @param matrix Edit distance matrix, the last row belongs to the node
+ * @param last_row Row of the last occurrence of every letter in the current word
+ * @param results Pairs of edit distance and word
+ */
+void Trie::fuzzyFind(const std::string& query, int tolerance, TrieNode* node,
+                     std::string& current, std::vector<int>& matrix, std::size_t* last_row,
+                     std::vector<std::pair<int, std::string>>& results) const
+{
+    const std::size_t columns = query.length() + 2;
+    const std::size_t i = current.length() + 1; // Row of the node
+
+    if(node->isEndOfWord() && matrix[i * columns + columns - 1] <= tolerance)
+    {
+        results.emplace_back(matrix[i * columns + columns - 1], current);
+    }
+
+    if(*std::min_element(matrix.begin() + i * columns + 1, matrix.end()) > tolerance)
+    {
+        return;
+    }
+
+    matrix.resize(matrix.size() + columns);
+
+    for(char c = 'a'; c <= 'z'; c++)
+    {
+        if(!node->hasChild(c))
         {
-            return;
+            continue;
         }
 
-        if(!node->hasChild(ch))
+        int* prev = &matrix[i * columns];
+        int* row = &matrix[(i + 1) * columns];
+        row[0] = prev[0];
+        row[1] = static_cast<int>(i);
+
+        // Column of the last match in the row
+        std::size_t db = 0;
+
+        for(std::size_t j = 1; j <= query.length(); j++)
         {
-            return;
+            char q = query[j - 1];
+
+            // A wildcard never occurs in a word, so it is never transposed
+            std::size_t k = (q >= 'a' && q <= 'z') ? last_row[q - 'a'] : 0;
+            std::size_t l = db;
+
+            int cost;
+            if(q == c || q == '*')
+            {
+                cost = 0;
+                db = j;
+            }
+            else
+            {
+                cost = 1;
+            }
+
+            int transposition = matrix[k * columns + l] +
+                                static_cast<int>((i - k - 1) + 1 + (j - l - 1));
+
+            row[j + 1] = std::min({
+                prev[j] + cost, // substitution
+                row[j] + 1, // insertion
+                prev[j + 1] + 1, // deletion
+                transposition // transposition
+            });
         }
 
-        this->collectMatches(pattern, index + 1, node->getChild(ch), current + ch, results);
+        std::size_t previous_row = last_row[c - 'a'];
+        last_row[c - 'a'] = i;
+        current.push_back(c);
+
+        this->fuzzyFind(query, tolerance, node->getChild(c), current, matrix, last_row,
+                        results);
+
+        current.pop_back();
+        last_row[c - 'a'] = previous_row;
     }
 
-    return;
+    matrix.resize(matrix.size() - columns);
 }
 
 /**
@@ -308,11 +541,18 @@ void Trie::print(TrieNode* node, const std::string& prefix) const
  */
 void Trie::serialize(std::ostream& os) const
 {
+    // Write the header: magic bytes and the version of the format
+    unsigned int version = TRIE_FORMAT_VERSION;
+    os.write(TRIE_MAGIC, sizeof(TRIE_MAGIC));
+    os.write(reinterpret_cast<char*>(&version), sizeof(version));
+
     this->serializeNode(os, this->root.get());
 }
 
 /**
- * @brief Serialize a Trie node recursively
+ * @brief Serialize a Trie node recursively. Every node is a LEB128 varint of a 27-bit
+ * bitmap: the lowest bit marks the end of a word, the next 26 bits mark the children
+ * from 'a' to 'z', which follow in this order
  *
  * @param os Output stream
  * @param node A Trie node to start from
@@ -324,62 +564,134 @@ void Trie::serializeNode(std::ostream& os, TrieNode* node) const
         return;
     }
 
-    bool is_end_of_word = node->isEndOfWord();
-    // Cast size_t (unsigned 64-bit) to unsigned char (8-bit) to reduce file size
-    unsigned char number_of_children = static_cast<unsigned char>(node->numberOfChildren());
+    std::uint32_t bitmap = node->isEndOfWord() ? 1 : 0;
+
+    for(char c = 'a'; c <= 'z'; c++)
+    {
+        if(node->hasChild(c))
+        {
+            bitmap |= std::uint32_t(1) << (c - 'a' + 1);
+        }
+    }
 
-    // Write whether this node denotes the end of the word and the
-    // number of existing children in the node to the output stream
-    os.write(reinterpret_cast<char*>(&is_end_of_word), sizeof(is_end_of_word));
-    os.write(reinterpret_cast<char*>(&number_of_children), sizeof(number_of_children));
+    Varint::write(os, bitmap);
 
     // Recursively serialize all children in the node
     for(char c = 'a'; c <= 'z'; c++)
     {
         if(node->hasChild(c))
         {
-            os.write(reinterpret_cast<char*>(&c), sizeof(c));
             this->serializeNode(os, node->getChild(c));
         }
     }
 }
 
 /**
- * @brief Deserialize an entire Trie
+ * @brief Deserialize an entire Trie. Files in the original format without
+ * a header are also supported
  *
  * @param is Input stream
  */
 void Trie::deserialize(std::istream& is)
 {
-    this->deserializeNode(is, this->root.get());
+    ByteReader::parseStream(is, [this](ByteReader& reader) { this->deserialize(reader); });
+}
+
+/**
+ * @brief Deserialize an entire Trie from memory. Files in the original format
+ * without a header are also supported
+ *
+ * @param reader Reader of the serialized data
+ */
+void Trie::deserialize(ByteReader& reader)
+{
+    // Files without a header start with the end-of-word flag of the root, which is
+    // either 0 or 1, so they can not be mistaken for the magic bytes
+    unsigned int version = 0;
+
+    if(reader.startsWith(TRIE_MAGIC, sizeof(TRIE_MAGIC)))
+    {
+        reader.read(sizeof(TRIE_MAGIC));
+        version = reader.readValue<unsigned int>();
+
+        if(version > TRIE_FORMAT_VERSION)
+        {
+            throw std::runtime_error("unsupported Trie format version " +
+                                     std::to_string(version));
+        }
+    }
+
+    this->deserializeNode(reader, this->root.get(), version);
 }
 
 /**
  * @brief Deserialize a Trie node recursively
  *
- * @param is Input stream
+ * @param reader Reader of the serialized data
  * @param node A Trie node to start from
+ * @param version Version of the format (0 for files without a header)
  */
-void Trie::deserializeNode(std::istream& is, TrieNode* node)
+void Trie::deserializeNode(ByteReader& reader, TrieNode* node, unsigned int version)
 {
-    bool is_end_of_word;
-    unsigned char number_of_children;
+    if(version >= 1)
+    {
+        std::uint64_t bitmap = reader.readVarint();
+
+        if(bitmap >> 27 != 0)
+        {
+            throw std::runtime_error("invalid Trie data");
+        }
+
+        node->setEndOfWord((bitmap & 1) != 0);
+
+        // Create all children before they are read, so they are not moved afterwards
+        for(char c = 'a'; c <= 'z'; c++)
+        {
+            if(bitmap & (std::uint64_t(1) << (c - 'a' + 1)))
+            {
+                node->createChild(c, this->pool);
+            }
+        }
+
+        // Recursively deserialize all children
+        for(char c = 'a'; c <= 'z'; c++)
+        {
+            if(node->hasChild(c))
+            {
+                this->deserializeNode(reader, node->getChild(c), version);
+            }
+        }
+
+        includeSubtreeDepths(node);
+        return;
+    }
 
     // Read whether this node denotes the end of the word and the
-    // number of existing children in the node from the input stream
-    is.read(reinterpret_cast<char*>(&is_end_of_word), sizeof(is_end_of_word));
-    is.read(reinterpret_cast<char*>(&number_of_children), sizeof(number_of_children));
+    // number of existing children in the node
+    unsigned char is_end_of_word = reader.readValue<unsigned char>();
+    unsigned char number_of_children = reader.readValue<unsigned char>();
+
+    if(is_end_of_word > 1 || number_of_children > 26)
+    {
+        throw std::runtime_error("invalid Trie data");
+    }
 
-    node->setEndOfWord(is_end_of_word);
+    node->setEndOfWord(is_end_of_word != 0);
 
     // Recursively deserialize all children
     for(unsigned char i = 0; i < number_of_children; i++)
     {
         // Read what character the child node is
-        char c;
-        is.read(reinterpret_cast<char*>(&c), sizeof(c));
+        char c = reader.readValue<char>();
 
-        node->createChild(c);
-        this->deserializeNode(is, node->getChild(c));
+        if(!std::isalpha(static_cast<unsigned char>(c)))
+        {
+            throw std::runtime_error("invalid Trie data");
+        }
+
+        node->createChild(c, this->pool);
+        this->deserializeNode(reader, node->getChild(c), version);
     }
+
+    includeSubtreeDepths(node);
 }
@@ -20,12 +20,18 @@
 #ifndef TRIE_H_INCLUDED
 #define TRIE_H_INCLUDED
 
+#include "byte_reader.h"
 #include "trie_node.h"
+#include "trie_node_pool.h"
 
+#include <cstddef>
+#include <functional>
 #include <istream>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 /**
@@ -40,6 +46,11 @@ private:
      *
      */
     std::unique_ptr<TrieNode> root;
+    /**
+     * @brief Pool that allocates all nodes below the root
+     *
+     */
+    TrieNodePool pool;
 
 public:
     /**
@@ -117,6 +128,61 @@ public:
     void collectMatches(const std::string& pattern, int index, TrieNode* node,
                         const std::string& current, std::vector<std::string>& results) const;
 
+    /**
+     * @brief Visit all words in Trie that match a given pattern, in alphabetical order.
+     * The words are built in a single buffer, so no strings are allocated
+     *
+     * @param pattern Pattern that words should match
+     * @param visitor Function that receives every matching word (valid only during the call)
+     * and returns false to stop the traversal
+     * @return false if the visitor stopped the traversal, true otherwise
+     */
+    bool collectMatches(const std::string& pattern,
+                        const std::function<bool(std::string_view)>& visitor) const;
+    /**
+     * @brief Visit all words in Trie that match a given pattern, in alphabetical order
+     *
+     * @param pattern Pattern that words should match
+     * @param index Starting index in the pattern
+     * @param node A Trie node to start from
+     * @param buffer Part of a word that has been built, restored before returning
+     * @param visitor Function that receives every matching word (valid only during the call)
+     * and returns false to stop the traversal
+     * @return false if the visitor stopped the traversal, true otherwise
+     */
+    bool collectMatches(const std::string& pattern, int index, TrieNode* node,
+                        std::string& buffer,
+                        const std::function<bool(std::string_view)>& visitor) const;
+
+    /**
+     * @brief Find all words in the Trie within the tolerance value of the query.
+     * The Damerau–Levenshtein edit distance matrix is computed one row per Trie node,
+     * so words sharing a prefix share its rows. A wildcard ('*') in the query
+     * matches any single character
+     *
+     * @param query Query
+     * @param tolerance Tolerance value (max edit distance)
+     * @return Pairs of edit distance and word, in alphabetical order of words
+     */
+    std::vector<std::pair<int, std::string>> fuzzyFind(const std::string& query,
+                                                       unsigned int tolerance = 2) const;
+    /**
+     * @brief Find all words within the tolerance value of the query below a given node.
+     * The branch is skipped if no cell of the node's row is within the tolerance,
+     * as the rows of longer words can not get smaller
+     *
+     * @param query Query
+     * @param tolerance Tolerance value (max edit distance)
+     * @param node A Trie node to start from
+     * @param current Part of a word that has been built (the word of the node)
+     * @param matrix Edit distance matrix, the last row belongs to the node
+     * @param last_row Row of the last occurrence of every letter in the current word
+     * @param results Pairs of edit distance and word
+     */
+    void fuzzyFind(const std::string& query, int tolerance, TrieNode* node,
+                   std::string& current, std::vector<int>& matrix, std::size_t* last_row,
+                   std::vector<std::pair<int, std::string>>& results) const;
+
     /**
      * @brief Print all words in the Trie starting from a root node
      *
@@ -137,7 +203,9 @@ public:
      */
     void serialize(std::ostream& os) const;
     /**
-     * @brief Serialize a Trie node recursively
+     * @brief Serialize a Trie node recursively. Every node is a LEB128 varint of a 27-bit
+     * bitmap: the lowest bit marks the end of a word, the next 26 bits mark the children
+     * from 'a' to 'z', which follow in this order
      *
      * @param os Output stream
      * @param node A Trie node to start from
@@ -145,18 +213,29 @@ public:
     void serializeNode(std::ostream& os, TrieNode* node) const;
 
     /**
-     * @brief Deserialize an entire Trie
+     * @brief Deserialize an entire Trie. Files in the original format without
+     * a header are also supported
      *
      * @param is Input stream
      */
     void deserialize(std::istream& is);
+
+    /**
+     * @brief Deserialize an entire Trie from memory. Files in the original format
+     * without a header are also supported
+     *
+     * @param reader Reader of the serialized data
+     */
+    void deserialize(ByteReader& reader);
+
     /**
      * @brief Deserialize a Trie node recursively
      *
-     * @param is Input stream
+     * @param reader Reader of the serialized data
      * @param node A Trie node to start from
+     * @param version Version of the format (0 for files without a header)
      */
-    void deserializeNode(std::istream& is, TrieNode* node);
+    void deserializeNode(ByteReader& reader, TrieNode* node, unsigned int version = 0);
 };
 
 #endif // TRIE_H_INCLUDED
@@ -19,14 +19,43 @@
 
 #include "trie_node.h"
 
-#include <cctype>
-#include <memory>
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Bit that marks the end of a word in the bitmap
+ *
+ */
+static const std::uint32_t TRIE_NODE_END_OF_WORD = std::uint32_t(1) << 26;
+
+/**
+ * @brief Bits that mark the existing children in the bitmap
+ *
+ */
+static const std::uint32_t TRIE_NODE_CHILDREN = TRIE_NODE_END_OF_WORD - 1;
 
 /**
  * @brief Default constructor
  *
  */
-TrieNode::TrieNode() : is_end_of_word(false), number_of_children(0), children(26) {}
+TrieNode::TrieNode() : bitmap(0), min_depth(TRIE_NODE_MAX_DEPTH), max_depth(0), children(nullptr)
+{
+}
+
+/**
+ * @brief Get the bit of a child in the bitmap
+ *
+ * @param c English character (a-zA-Z)
+ * @return Bit of the child, 0 if the character is not a letter
+ */
+std::uint32_t TrieNode::childBit(char c)
+{
+    // Setting bit 5 turns an ASCII uppercase letter into the lowercase one
+    std::uint32_t index = (static_cast<unsigned char>(c) | 0x20u) - 'a';
+    return (index < 26) ? (std::uint32_t(1) << index) : 0;
+}
 
 /**
  * @brief Check if this node marks the end of a word
@@ -35,7 +64,7 @@ TrieNode::TrieNode() : is_end_of_word(false), number_of_children(0), children(26
  */
 bool TrieNode::isEndOfWord() const
 {
-    return this->is_end_of_word;
+    return (this->bitmap & TRIE_NODE_END_OF_WORD) != 0;
 }
 
 /**
@@ -45,7 +74,14 @@ bool TrieNode::isEndOfWord() const
  */
 void TrieNode::setEndOfWord(bool is_end_of_word)
 {
-    this->is_end_of_word = is_end_of_word;
+    if(is_end_of_word)
+    {
+        this->bitmap |= TRIE_NODE_END_OF_WORD;
+    }
+    else
+    {
+        this->bitmap &= ~TRIE_NODE_END_OF_WORD;
+    }
 }
 
 /**
@@ -55,7 +91,64 @@ void TrieNode::setEndOfWord(bool is_end_of_word)
  */
 size_t TrieNode::numberOfChildren() const
 {
-    return this->number_of_children;
+    return static_cast<size_t>(__builtin_popcount(this->bitmap & TRIE_NODE_CHILDREN));
+}
+
+/**
+ * @brief Get the bitmap of the existing children
+ *
+ * @return Bitmap with bit i set if a child exists for the character 'a' + i
+ */
+std::uint32_t TrieNode::getChildMask() const
+{
+    return this->bitmap & TRIE_NODE_CHILDREN;
+}
+
+/**
+ * @brief Get the smallest number of characters from this node to the end of a word
+ *
+ * @return Smallest remaining depth (greater than the largest one if no word
+ * ends below the node)
+ */
+unsigned int TrieNode::getMinDepth() const
+{
+    return this->min_depth;
+}
+
+/**
+ * @brief Get the largest number of characters from this node to the end of a word
+ *
+ * @return Largest remaining depth (UINT_MAX if it is too large to be stored)
+ */
+unsigned int TrieNode::getMaxDepth() const
+{
+    return (this->max_depth == TRIE_NODE_MAX_DEPTH) ? UINT_MAX : this->max_depth;
+}
+
+/**
+ * @brief Extend the range of remaining depths with a word that ends below this node
+ *
+ * @param depth Number of characters from this node to the end of the word
+ */
+void TrieNode::includeDepth(unsigned int depth)
+{
+    std::uint16_t stored = static_cast<std::uint16_t>(std::min(depth, TRIE_NODE_MAX_DEPTH));
+    this->min_depth = std::min(this->min_depth, stored);
+    this->max_depth = std::max(this->max_depth, stored);
+}
+
+/**
+ * @brief Extend the range of remaining depths with all words below a child node
+ *
+ * @param child Child node
+ */
+void TrieNode::includeChildDepths(const TrieNode& child)
+{
+    if(child.min_depth <= child.max_depth)
+    {
+        this->includeDepth(child.min_depth + 1u);
+        this->includeDepth(child.max_depth + 1u);
+    }
 }
 
 /**
@@ -66,7 +159,7 @@ size_t TrieNode::numberOfChildren() const
  */
 bool TrieNode::hasChild(char c) const
 {
-    return this->children[std::tolower(c) - 'a'] != nullptr;
+    return (this->bitmap & childBit(c)) != 0;
 }
 
 /**
@@ -77,21 +170,46 @@ bool TrieNode::hasChild(char c) const
  */
 TrieNode* TrieNode::getChild(char c) const
 {
-    return this->children[std::tolower(c) - 'a'].get();
+    std::uint32_t bit = childBit(c);
+
+    if((this->bitmap & bit) == 0)
+    {
+        return nullptr;
+    }
+
+    return this->children + __builtin_popcount(this->bitmap & (bit - 1));
 }
 
 /**
- * @brief Create a new child node for the given character, if it doesn't already exist
+ * @brief Create a new child node for the given character, if it doesn't already exist.
+ * The children are moved to a larger block, so pointers to them become invalid
  *
  * @param c English character (a-zA-Z)
+ * @param pool Pool that allocates the children
  */
-void TrieNode::createChild(char c)
+void TrieNode::createChild(char c, TrieNodePool& pool)
 {
-    char ch = std::tolower(c);
+    std::uint32_t bit = childBit(c);
 
-    if(!this->hasChild(c))
+    if(bit == 0 || (this->bitmap & bit) != 0)
     {
-        this->children[ch - 'a'] = std::make_unique<TrieNode>();
-        this->number_of_children++;
+        return;
     }
+
+    std::size_t count = this->numberOfChildren();
+    std::size_t position = static_cast<std::size_t>(__builtin_popcount(this->bitmap & (bit - 1)));
+    TrieNode* block = pool.allocate(count + 1);
+
+    // Children of the moved nodes stay where they are, so copying the nodes is enough
+    std::copy(this->children, this->children + position, block);
+    block[position] = TrieNode();
+    std::copy(this->children + position, this->children + count, block + position + 1);
+
+    if(count != 0)
+    {
+        pool.release(this->children, count);
+    }
+
+    this->children = block;
+    this->bitmap |= bit;
 }
@@ -20,32 +20,57 @@
 #ifndef TRIE_NODE_H_INCLUDED
 #define TRIE_NODE_H_INCLUDED
 
+#include "trie_node_pool.h"
+
 #include <cstddef>
-#include <memory>
-#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Largest remaining depth stored in a node
+ *
+ */
+const unsigned int TRIE_NODE_MAX_DEPTH = 0xFFFF;
 
 /**
- * @brief Class that represents a single node in a Trie
+ * @brief Class that represents a node of the Trie. Existing children are marked in a
+ * bitmap and stored next to each other in the order of their characters, so the child
+ * of a character is found by counting the bits of the preceding characters
  *
  */
 class TrieNode
 {
 private:
     /**
-     * @brief Flag to denote the end of a word in a path of the Trie
+     * @brief Bits 0-25 mark the existing children for characters a-z,
+     * bit 26 marks the end of a word
+     *
+     */
+    std::uint32_t bitmap;
+    /**
+     * @brief The smallest number of characters from this node to the end of a word
+     * below it (TRIE_NODE_MAX_DEPTH if there is no such word yet)
+     *
+     */
+    std::uint16_t min_depth;
+    /**
+     * @brief The largest number of characters from this node to the end of a word
+     * below it (TRIE_NODE_MAX_DEPTH means any larger number)
      *
      */
-    bool is_end_of_word;
+    std::uint16_t max_depth;
     /**
-     * @brief Number of existing children (elements that are not nullptr)
+     * @brief Block with the children of the node (nullptr if there are none)
      *
      */
-    size_t number_of_children;
+    TrieNode* children;
+
     /**
-     * @brief Children of the node
+     * @brief Get the bit of a child in the bitmap
      *
+     * @param c English character (a-zA-Z)
+     * @return Bit of the child, 0 if the character is not a letter
      */
-    std::vector<std::unique_ptr<TrieNode>> children;
+    static std::uint32_t childBit(char c);
 
 public:
     /**
@@ -60,6 +85,7 @@ public:
      * @return true if this node is the end of a word, false otherwise
      */
     bool isEndOfWord() const;
+
     /**
      * @brief Set whether this node represents the end of a word
      *
@@ -74,6 +100,42 @@ public:
      */
     size_t numberOfChildren() const;
 
+    /**
+     * @brief Get the bitmap of the existing children
+     *
+     * @return Bitmap with bit i set if a child exists for the character 'a' + i
+     */
+    std::uint32_t getChildMask() const;
+
+    /**
+     * @brief Get the smallest number of characters from this node to the end of a word
+     *
+     * @return Smallest remaining depth (greater than the largest one if no word
+     * ends below the node)
+     */
+    unsigned int getMinDepth() const;
+
+    /**
+     * @brief Get the largest number of characters from this node to the end of a word
+     *
+     * @return Largest remaining depth (UINT_MAX if it is too large to be stored)
+     */
+    unsigned int getMaxDepth() const;
+
+    /**
+     * @brief Extend the range of remaining depths with a word that ends below this node
+     *
+     * @param depth Number of characters from this node to the end of the word
+     */
+    void includeDepth(unsigned int depth);
+
+    /**
+     * @brief Extend the range of remaining depths with all words below a child node
+     *
+     * @param child Child node
+     */
+    void includeChildDepths(const TrieNode& child);
+
     /**
      * @brief Check whether a child node exists for the given character
      *
@@ -81,6 +143,7 @@ public:
      * @return true if a child exists, false otherwise
      */
     bool hasChild(char c) const;
+
     /**
      * @brief Get the child node associated with the given character
      *
@@ -88,12 +151,15 @@ public:
      * @return Pointer to the child node if it exists, nullptr if it doesn't
      */
     TrieNode* getChild(char c) const;
+
     /**
-     * @brief Create a new child node for the given character, if it doesn't already exist
+     * @brief Create a new child node for the given character, if it doesn't already exist.
+     * The children are moved to a larger block, so pointers to them become invalid
      *
      * @param c English character (a-zA-Z)
+     * @param pool Pool that allocates the children
      */
-    void createChild(char c);
+    void createChild(char c, TrieNodePool& pool);
 };
 
 #endif // TRIE_NODE_H_INCLUDED
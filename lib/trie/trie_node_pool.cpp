@@ -0,0 +1,102 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "trie_node_pool.h"
+#include "trie_node.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Number of nodes in a chunk
+ *
+ */
+static const std::size_t TRIE_NODE_POOL_CHUNK_SIZE = 4096;
+
+/**
+ * @brief Maximum number of nodes in a block (one for each letter)
+ *
+ */
+static const std::size_t TRIE_NODE_POOL_MAX_BLOCK = 26;
+
+/**
+ * @brief Default constructor
+ *
+ */
+TrieNodePool::TrieNodePool() :
+    chunks(), used(TRIE_NODE_POOL_CHUNK_SIZE), free_blocks(TRIE_NODE_POOL_MAX_BLOCK)
+{
+}
+
+/**
+ * @brief Allocate a block of nodes
+ *
+ * @param count Number of nodes (1-26)
+ * @return Pointer to the first node of the block
+ */
+TrieNode* TrieNodePool::allocate(std::size_t count)
+{
+    std::vector<TrieNode*>& reusable = this->free_blocks[count - 1];
+
+    if(!reusable.empty())
+    {
+        TrieNode* block = reusable.back();
+        reusable.pop_back();
+        return block;
+    }
+
+    if(this->used + count > TRIE_NODE_POOL_CHUNK_SIZE)
+    {
+        // Keep the rest of the last chunk for smaller blocks
+        if(this->used < TRIE_NODE_POOL_CHUNK_SIZE)
+        {
+            this->release(this->chunks.back().get() + this->used,
+                          TRIE_NODE_POOL_CHUNK_SIZE - this->used);
+        }
+
+        this->chunks.push_back(std::make_unique<TrieNode[]>(TRIE_NODE_POOL_CHUNK_SIZE));
+        this->used = 0;
+    }
+
+    TrieNode* block = this->chunks.back().get() + this->used;
+    this->used += count;
+    return block;
+}
+
+/**
+ * @brief Release a block of nodes so it can be reused
+ *
+ * @param block Pointer to the first node of the block
+ * @param count Number of nodes (1-26)
+ */
+void TrieNodePool::release(TrieNode* block, std::size_t count)
+{
+    this->free_blocks[count - 1].push_back(block);
+}
+
+/**
+ * @brief Get the memory reserved by the pool
+ *
+ * @return Size in bytes
+ */
+std::size_t TrieNodePool::memoryUsage() const
+{
+    return this->chunks.size() * TRIE_NODE_POOL_CHUNK_SIZE * sizeof(TrieNode);
+}
@@ -0,0 +1,86 @@
+/*
+    Text Recovery
+    A C++ program for restoring damaged text
+    Copyright (C) 2025 Yurii Govor
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRIE_NODE_POOL_H_INCLUDED
+#define TRIE_NODE_POOL_H_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class TrieNode;
+
+/**
+ * @brief Class that allocates the children of Trie nodes. The children of a node are
+ * stored next to each other in a block. Blocks are cut from large chunks, which are
+ * never moved, so pointers to nodes stay valid while the Trie grows. Released blocks
+ * are reused by later allocations of the same size
+ *
+ */
+class TrieNodePool
+{
+private:
+    /**
+     * @brief Chunks of nodes
+     *
+     */
+    std::vector<std::unique_ptr<TrieNode[]>> chunks;
+    /**
+     * @brief Number of nodes used in the last chunk
+     *
+     */
+    std::size_t used;
+    /**
+     * @brief Released blocks by size (index 0 holds blocks of a single node)
+     *
+     */
+    std::vector<std::vector<TrieNode*>> free_blocks;
+
+public:
+    /**
+     * @brief Default constructor
+     *
+     */
+    TrieNodePool();
+
+    /**
+     * @brief Allocate a block of nodes
+     *
+     * @param count Number of nodes (1-26)
+     * @return Pointer to the first node of the block
+     */
+    TrieNode* allocate(std::size_t count);
+
+    /**
+     * @brief Release a block of nodes so it can be reused
+     *
+     * @param block Pointer to the first node of the block
+     * @param count Number of nodes (1-26)
+     */
+    void release(TrieNode* block, std::size_t count);
+
+    /**
+     * @brief Get the memory reserved by the pool
+     *
+     * @return Size in bytes
+     */
+    std::size_t memoryUsage() const;
+};
+
+#endif // TRIE_NODE_POOL_H_INCLUDED